@@ -1,24 +1,25 @@
+// gmp.h first for the mpz_t conversions of bigInt.h
+#ifdef BIGINT_GMP
+#include <gmp.h>
+#endif
+
+#include "bigInt.h"
+
 #include <assert.h>
 #include <ctype.h>
-#include <fcntl.h>
-#include <gmp.h>
-#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/random.h>
 #include <time.h>
 #include <unistd.h>
 
-typedef enum { false, true } bool;
-
-typedef struct {
-  uint32_t *digits;
-  int size;
-  int capacity;
-} BigInt;
-
 BigInt *bigint_init(uint32_t value) {
-  BigInt *num = malloc(sizeof(BigInt));
+  BigInt *num = calloc(1, sizeof(BigInt));
   num->capacity = 1;
   num->size = 1;
   num->digits = malloc(sizeof(uint32_t) * num->capacity);
@@ -27,7 +28,7 @@ BigInt *bigint_init(uint32_t value) {
 }
 
 BigInt *bigint_init_size(size_t size) {
-  BigInt *bi = malloc(sizeof(BigInt));
+  BigInt *bi = calloc(1, sizeof(BigInt));
   bi->capacity = size;
   bi->size = 1;
   bi->digits = calloc(size, sizeof(uint32_t));
@@ -35,11 +36,12 @@ BigInt *bigint_init_size(size_t size) {
 }
 
 BigInt *bigint_copy(const BigInt *num) {
-  BigInt *copy = malloc(sizeof(BigInt));
+  BigInt *copy = calloc(1, sizeof(BigInt));
   copy->size = num->size;
   copy->capacity = num->capacity;
   copy->digits = malloc(sizeof(uint32_t) * copy->capacity);
   memcpy(copy->digits, num->digits, sizeof(uint32_t) * copy->size);
+  copy->negative = num->negative;
   return copy;
 }
 
@@ -63,8 +65,14 @@ void bigint_resize(BigInt *num, int new_capacity) {
   num->capacity = new_capacity;
 }
 
+bool bigint_is_zero(const BigInt *a) {
+  for (int i = 0; i < a->size; i++)
+    if (a->digits[i]) return false;
+  return true;
+}
+
 void bigint_print(const BigInt *num) {
-  printf("0x");
+  printf(num->negative ? "-0x" : "0x");
   for (int i = num->size - 1; i >= 0; i--) {
     printf("%08X", num->digits[i]);
   }
@@ -73,7 +81,7 @@ void bigint_print(const BigInt *num) {
 
 BigInt *bigint_from_hex(const char *hex_str) {
   int len = strlen(hex_str);
-  BigInt *num = malloc(sizeof(BigInt));
+  BigInt *num = calloc(1, sizeof(BigInt));
   num->size = 0;
   num->capacity = (len + 7) / 8;
   num->digits = calloc(num->capacity, sizeof(uint32_t));
@@ -92,7 +100,7 @@ BigInt *bigint_from_hex(const char *hex_str) {
         : (hex_digit >= 'a' && hex_digit <= 'f') ? (hex_digit - 'a' + 10)
                                                  : 0;
 
-    current |= (value << shift);
+    current |= ((uint32_t)value << shift);
     shift += 4;
 
     if (shift == 32) {
@@ -103,7 +111,11 @@ BigInt *bigint_from_hex(const char *hex_str) {
   }
 
   if (shift > 0) num->digits[num->size++] = current;
+  if (num->size == 0) num->digits[num->size++] = 0;
 
+  // Leading minus sign
+  while (isspace((unsigned char)*hex_str)) hex_str++;
+  num->negative = *hex_str == '-' && !bigint_is_zero(num);
   return num;
 }
 
@@ -129,9 +141,204 @@ BigInt *bigint_read_from_file(const char *filename) {
     return NULL;
   }
 
-  return bigint_from_hex(hex_str);
+  BigInt *num = bigint_from_hex(hex_str);
   free(hex_str);
   fclose(file);
+  return num;
+}
+
+static BigInt *dec_parse(const char *str, const char **end);
+
+// Zero-copy view over count limbs, least significant first. The view does
+// not own the limbs : it must not be freed nor resized.
+BigInt bigint_view(const uint32_t *words, int count, bool negative) {
+  BigInt view = {(uint32_t *)words, count, count, negative};
+  while (view.size > 1 && view.digits[view.size - 1] == 0) view.size--;
+  view.negative = negative && !bigint_is_zero(&view);
+  return view;
+}
+
+// Copy of count limbs, least significant first
+BigInt *bigint_from_words(const uint32_t *words, int count, bool negative) {
+  BigInt *num = bigint_init_size(count > 0 ? count : 1);
+  memcpy(num->digits, words, sizeof(uint32_t) * count);
+  num->size = count > 0 ? count : 1;
+  bigint_trim(num);
+  num->negative = negative && !bigint_is_zero(num);
+  return num;
+}
+
+// Limbs of num without copy, *count set to the number of significant ones
+const uint32_t *bigint_words(const BigInt *num, int *count) {
+  int n = num->size;
+  while (n > 1 && num->digits[n - 1] == 0) n--;
+  *count = n;
+  return num->digits;
+}
+
+// Raw binary format : int32 number of limbs, negative for a negative
+// number, then the limbs least significant first, in host byte order
+bool bigint_write_raw(FILE *file, const BigInt *num) {
+  int count;
+  const uint32_t *words = bigint_words(num, &count);
+  int32_t header = (num->negative && !bigint_is_zero(num)) ? -count : count;
+  return fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(words, sizeof(uint32_t), count, file) == (size_t)count;
+}
+
+BigInt *bigint_read_raw(FILE *file) {
+  int32_t header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header == 0 ||
+      header == INT32_MIN)
+    return NULL;
+  int count = header < 0 ? -header : header;
+  BigInt *num = bigint_init_size(count);
+  if (fread(num->digits, sizeof(uint32_t), count, file) != (size_t)count) {
+    bigint_free(num);
+    return NULL;
+  }
+  num->size = count;
+  bigint_trim(num);
+  num->negative = header < 0 && !bigint_is_zero(num);
+  return num;
+}
+
+// Whole content of a file, NUL-terminated, allocated with malloc
+static char *read_whole_file(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    perror("Erreur d'ouverture du fichier");
+    return NULL;
+  }
+  size_t cap = 1 << 16, len = 0, n;
+  char *buf = malloc(cap);
+  while ((n = fread(buf + len, 1, cap - len - 1, file)) > 0) {
+    len += n;
+    if (cap - len - 1 == 0) buf = realloc(buf, cap *= 2);
+  }
+  buf[len] = '\0';
+  fclose(file);
+  return buf;
+}
+
+// One decimal integer per non-empty line, as in the .enc files. Returns an
+// array of *count numbers allocated with malloc, NULL on error.
+BigInt **bigint_read_dec_file(const char *filename, int *count) {
+  char *buf = read_whole_file(filename);
+  if (!buf) return NULL;
+  int cap = 256;
+  BigInt **nums = malloc(sizeof(BigInt *) * cap);
+  *count = 0;
+  for (const char *p = buf; *p;) {
+    while (isspace((unsigned char)*p)) p++;
+    if (!*p) break;
+    const char *end;
+    BigInt *num = dec_parse(p, &end);
+    if (end == p) {
+      fprintf(stderr, "Entier décimal invalide dans %s\n", filename);
+      bigint_free(num);
+      for (int i = 0; i < *count; i++) bigint_free(nums[i]);
+      free(nums);
+      free(buf);
+      *count = 0;
+      return NULL;
+    }
+    if (*count == cap) nums = realloc(nums, sizeof(BigInt *) * (cap *= 2));
+    nums[(*count)++] = num;
+    p = end;
+  }
+  free(buf);
+  return nums;
+}
+
+bool bigint_write_dec_file(const char *filename, BigInt *const *nums,
+                           int count) {
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    perror("Erreur d'ouverture du fichier");
+    return false;
+  }
+  bool ok = true;
+  for (int i = 0; i < count && ok; i++) {
+    char *str = bigint_to_dec(nums[i]);
+    ok = fprintf(file, "%s%s", i ? "\n" : "", str) >= 0;
+    free(str);
+  }
+  return fclose(file) == 0 && ok;
+}
+
+// Value of "key" in a flat JSON object as written by the client : decimal
+// integers, quoted or not, or an array of them (pk.json, sk.json)
+static const char *json_find_key(const char *json, const char *key) {
+  size_t len = strlen(key);
+  for (const char *p = strchr(json, '"'); p; p = strchr(p + 1, '"')) {
+    if (strncmp(p + 1, key, len) != 0 || p[len + 1] != '"') continue;
+    const char *v = p + len + 2;
+    while (isspace((unsigned char)*v)) v++;
+    if (*v != ':') continue;
+    v++;
+    while (isspace((unsigned char)*v)) v++;
+    return v;
+  }
+  return NULL;
+}
+
+// Parses a JSON integer, quoted or not, *end set past it
+static BigInt *json_parse_int(const char *p, const char **end) {
+  bool quoted = *p == '"';
+  BigInt *num = dec_parse(p + quoted, end);
+  if (*end == p + quoted) {
+    bigint_free(num);
+    return NULL;
+  }
+  if (quoted && **end == '"') (*end)++;
+  return num;
+}
+
+BigInt *bigint_read_json_int(const char *filename, const char *key) {
+  char *json = read_whole_file(filename);
+  if (!json) return NULL;
+  const char *p = json_find_key(json, key), *end;
+  BigInt *num = p ? json_parse_int(p, &end) : NULL;
+  if (!num)
+    fprintf(stderr, "Clé %s absente ou invalide dans %s\n", key, filename);
+  free(json);
+  return num;
+}
+
+// Array of integers of "key", *count numbers allocated with malloc
+BigInt **bigint_read_json_array(const char *filename, const char *key,
+                                int *count) {
+  char *json = read_whole_file(filename);
+  if (!json) return NULL;
+  const char *p = json_find_key(json, key);
+  if (!p || *p != '[') {
+    fprintf(stderr, "Tableau %s absent dans %s\n", key, filename);
+    free(json);
+    return NULL;
+  }
+  int cap = 256;
+  BigInt **nums = malloc(sizeof(BigInt *) * cap);
+  *count = 0;
+  p++;
+  while (true) {
+    while (isspace((unsigned char)*p) || *p == ',') p++;
+    if (*p == ']') break;
+    const char *end;
+    BigInt *num = json_parse_int(p, &end);
+    if (!num) {
+      fprintf(stderr, "Entier invalide dans %s de %s\n", key, filename);
+      for (int i = 0; i < *count; i++) bigint_free(nums[i]);
+      free(nums);
+      free(json);
+      return NULL;
+    }
+    if (*count == cap) nums = realloc(nums, sizeof(BigInt *) * (cap *= 2));
+    nums[(*count)++] = num;
+    p = end;
+  }
+  free(json);
+  return nums;
 }
 
 // Remove leading zeros
@@ -142,32 +349,504 @@ void bigint_trim(BigInt *a) {
   }
 }
 
-BigInt *bigint_add(const BigInt *a, const BigInt *b) {
-  int maxSize = (a->size > b->size) ? a->size : b->size;
-  BigInt *result = malloc(sizeof(BigInt));
-  result->capacity = maxSize + 1;
-  result->digits = calloc(result->capacity, sizeof(uint32_t));
-  result->size = 0;
+// GMP backend : with -DBIGINT_GMP the arithmetic entry points below forward
+// to these and run on mpz_t, the BigInt layout staying the same
+#ifdef BIGINT_GMP
+// Magnitude only, as the unsigned entry points ignore signs
+static void bigint_gmp_import(mpz_t z, const BigInt *a) {
+  mpz_import(z, a->size, -1, sizeof(uint32_t), 0, 0, a->digits);
+}
+
+typedef void (*bigint_gmp_op)(mpz_ptr, mpz_srcptr, mpz_srcptr);
+
+static BigInt *bigint_gmp_binary(bigint_gmp_op op, const BigInt *a,
+                                 const BigInt *b) {
+  mpz_t za, zb;
+  mpz_inits(za, zb, NULL);
+  bigint_gmp_import(za, a);
+  bigint_gmp_import(zb, b);
+  op(za, za, zb);
+  BigInt *r = bigint_from_mpz(za);
+  mpz_clears(za, zb, NULL);
+  return r;
+}
+
+static void bigint_gmp_divmod(const BigInt *a, const BigInt *m, BigInt **q,
+                              BigInt **r) {
+  mpz_t za, zm, zq, zr;
+  mpz_inits(za, zm, zq, zr, NULL);
+  bigint_gmp_import(za, a);
+  bigint_gmp_import(zm, m);
+  mpz_tdiv_qr(zq, zr, za, zm);
+  if (q) *q = bigint_from_mpz(zq);
+  if (r) *r = bigint_from_mpz(zr);
+  mpz_clears(za, zm, zq, zr, NULL);
+}
+
+static BigInt *bigint_gmp_mul_low(const BigInt *a, const BigInt *b,
+                                  int k_bits) {
+  mpz_t za, zb;
+  mpz_inits(za, zb, NULL);
+  bigint_gmp_import(za, a);
+  bigint_gmp_import(zb, b);
+  mpz_mul(za, za, zb);
+  mpz_fdiv_r_2exp(za, za, k_bits);
+  BigInt *r = bigint_from_mpz(za);
+  mpz_clears(za, zb, NULL);
+  return r;
+}
+
+static BigInt *bigint_gmp_modinv_pow2(const BigInt *a, int k) {
+  mpz_t za, zm;
+  mpz_inits(za, zm, NULL);
+  bigint_gmp_import(za, a);
+  mpz_setbit(zm, k);
+  mpz_invert(za, za, zm);
+  BigInt *r = bigint_from_mpz(za);
+  mpz_clears(za, zm, NULL);
+  return r;
+}
+
+static BigInt *bigint_gmp_powm(const BigInt *base, const BigInt *exp,
+                               const BigInt *modulus, bool ct) {
+  mpz_t zb, ze, zm;
+  mpz_inits(zb, ze, zm, NULL);
+  bigint_gmp_import(zb, base);
+  bigint_gmp_import(ze, exp);
+  bigint_gmp_import(zm, modulus);
+  if (ct && mpz_sgn(ze) > 0)
+    mpz_powm_sec(zb, zb, ze, zm);
+  else
+    mpz_powm(zb, zb, ze, zm);
+  BigInt *r = bigint_from_mpz(zb);
+  mpz_clears(zb, ze, zm, NULL);
+  return r;
+}
+
+static bool bigint_gmp_is_probable_prime(const BigInt *n, int iterations) {
+  mpz_t zn;
+  mpz_init(zn);
+  bigint_gmp_import(zn, n);
+  bool prime = mpz_probab_prime_p(zn, iterations) > 0;
+  mpz_clear(zn);
+  return prime;
+}
+
+static uint32_t bigint_gmp_mod_small(const BigInt *a, uint32_t d) {
+  mpz_t za;
+  mpz_init(za);
+  bigint_gmp_import(za, a);
+  uint32_t r = mpz_fdiv_ui(za, d);
+  mpz_clear(za);
+  return r;
+}
+#endif
+
+// SIMD kernels, selected at run time from CPUID with a scalar fallback :
+// AVX2 for additions, subtractions and shifts of word arrays, AVX-512 IFMA
+// (52-bit limbs) for products and Montgomery products.
+// BIGINT_SIMD=scalar|avx2|ifma in the environment caps the level.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(BIGINT_NO_SIMD)
+#define BIGINT_SIMD_X86
+#endif
+
+enum { BIGINT_SIMD_SCALAR, BIGINT_SIMD_AVX2, BIGINT_SIMD_IFMA };
+static const char *bigint_simd_names[] = {"scalar", "avx2", "ifma"};
+static int bigint_simd = BIGINT_SIMD_SCALAR;
+static pthread_once_t bigint_simd_once = PTHREAD_ONCE_INIT;
+
+// Level computed in a local, published once
+static void bigint_simd_detect(void) {
+  int level = BIGINT_SIMD_SCALAR;
+#ifdef BIGINT_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    level = BIGINT_SIMD_AVX2;
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512ifma"))
+      level = BIGINT_SIMD_IFMA;
+  }
+#endif
+  const char *cap = getenv("BIGINT_SIMD");
+  for (int i = 0; cap && i < level; i++) {
+    if (strcmp(cap, bigint_simd_names[i]) == 0) level = i;
+  }
+  bigint_simd = level;
+}
+
+int bigint_simd_level() {
+  pthread_once(&bigint_simd_once, bigint_simd_detect);
+  return bigint_simd;
+}
+
+const char *bigint_simd_name() { return bigint_simd_names[bigint_simd_level()]; }
+
+const char *bigint_backend_name() {
+#ifdef BIGINT_GMP
+  return "gmp";
+#else
+  static char name[16];
+  snprintf(name, sizeof(name), "native-%s", bigint_simd_name());
+  return name;
+#endif
+}
+
+// r = a + b on n words, returns the carry
+static uint32_t bigint_add_n_scalar(uint32_t *r, const uint32_t *a,
+                                    const uint32_t *b, int n) {
   uint64_t carry = 0;
-  for (int i = 0; i < maxSize; i++) {
-    uint64_t tmp = carry;
-    if (i < a->size) {
-      tmp += a->digits[i];
+  for (int i = 0; i < n; i++) {
+    uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+    r[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+  return (uint32_t)carry;
+}
+
+// r = a - b on n words, returns the borrow
+static uint32_t bigint_sub_n_scalar(uint32_t *r, const uint32_t *a,
+                                    const uint32_t *b, int n) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < n; i++) {
+    uint64_t diff = (uint64_t)a[i] - b[i] - borrow;
+    r[i] = (uint32_t)diff;
+    borrow = (diff >> 32) & 1;
+  }
+  return (uint32_t)borrow;
+}
+
+// r = a << bits on n words with 0 < bits < 32, returns the bits shifted
+// out. Runs from the top so that r may be a.
+static uint32_t bigint_lshift_scalar(uint32_t *r, const uint32_t *a, int n,
+                                     int bits) {
+  uint32_t out = a[n - 1] >> (32 - bits);
+  for (int i = n - 1; i > 0; i--)
+    r[i] = (a[i] << bits) | (a[i - 1] >> (32 - bits));
+  r[0] = a[0] << bits;
+  return out;
+}
+
+// r = a >> bits on n words with 0 < bits < 32, the top word receiving the
+// low bits of high. Runs from the bottom so that r may be a.
+static void bigint_rshift_scalar(uint32_t *r, const uint32_t *a, int n,
+                                 int bits, uint32_t high) {
+  for (int i = 0; i < n - 1; i++)
+    r[i] = (a[i] >> bits) | (a[i + 1] << (32 - bits));
+  r[n - 1] = (a[n - 1] >> bits) | (high << (32 - bits));
+}
+
+#ifdef BIGINT_SIMD_X86
+#include <immintrin.h>
+
+// Carries between the 8 lanes of a vector sum : lanes in g generate a carry,
+// lanes in p (all ones) propagate one. Adding g << 1 to p runs the carries
+// through the p lanes, the xor leaves the lanes receiving a carry.
+// *carry is the carry in on entry and the carry out on return.
+static inline uint32_t bigint_lane_carries(uint32_t g, uint32_t p,
+                                           uint32_t *carry) {
+  uint32_t c = ((g << 1) | *carry) + p;
+  *carry = c >> 8;
+  return (c ^ p) & 0xFF;
+}
+
+__attribute__((target("avx2"))) static inline __m256i bigint_lane_mask(
+    uint32_t c) {
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  return _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(c), lanes),
+                          _mm256_set1_epi32(1));
+}
+
+__attribute__((target("avx2"))) static uint32_t bigint_add_n_avx2(
+    uint32_t *r, const uint32_t *a, const uint32_t *b, int n) {
+  const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+  const __m256i ones = _mm256_set1_epi32(-1);
+  uint32_t carry = 0;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i sum = _mm256_add_epi32(va, vb);
+    // Unsigned sum < a where the lane overflowed
+    __m256i gen = _mm256_cmpgt_epi32(_mm256_xor_si256(va, sign),
+                                     _mm256_xor_si256(sum, sign));
+    __m256i prop = _mm256_cmpeq_epi32(sum, ones);
+    uint32_t c = bigint_lane_carries(
+        _mm256_movemask_ps(_mm256_castsi256_ps(gen)),
+        _mm256_movemask_ps(_mm256_castsi256_ps(prop)), &carry);
+    sum = _mm256_add_epi32(sum, bigint_lane_mask(c));
+    _mm256_storeu_si256((__m256i *)(r + i), sum);
+  }
+  for (; i < n; i++) {
+    uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+    r[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+  return carry;
+}
+
+__attribute__((target("avx2"))) static uint32_t bigint_sub_n_avx2(
+    uint32_t *r, const uint32_t *a, const uint32_t *b, int n) {
+  const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+  uint32_t borrow = 0;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i diff = _mm256_sub_epi32(va, vb);
+    // Unsigned a < b where the lane borrows, zero lanes pass a borrow on
+    __m256i gen = _mm256_cmpgt_epi32(_mm256_xor_si256(vb, sign),
+                                     _mm256_xor_si256(va, sign));
+    __m256i prop = _mm256_cmpeq_epi32(diff, _mm256_setzero_si256());
+    uint32_t c = bigint_lane_carries(
+        _mm256_movemask_ps(_mm256_castsi256_ps(gen)),
+        _mm256_movemask_ps(_mm256_castsi256_ps(prop)), &borrow);
+    diff = _mm256_sub_epi32(diff, bigint_lane_mask(c));
+    _mm256_storeu_si256((__m256i *)(r + i), diff);
+  }
+  for (; i < n; i++) {
+    uint64_t d = (uint64_t)a[i] - b[i] - borrow;
+    r[i] = (uint32_t)d;
+    borrow = (d >> 32) & 1;
+  }
+  return borrow;
+}
+
+__attribute__((target("avx2"))) static uint32_t bigint_lshift_avx2(
+    uint32_t *r, const uint32_t *a, int n, int bits) {
+  uint32_t out = a[n - 1] >> (32 - bits);
+  __m128i left = _mm_cvtsi32_si128(bits), right = _mm_cvtsi32_si128(32 - bits);
+  int i = n - 8;
+  for (; i >= 1; i -= 8) {
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i lo = _mm256_loadu_si256((const __m256i *)(a + i - 1));
+    _mm256_storeu_si256((__m256i *)(r + i),
+                        _mm256_or_si256(_mm256_sll_epi32(hi, left),
+                                        _mm256_srl_epi32(lo, right)));
+  }
+  for (i += 7; i > 0; i--) r[i] = (a[i] << bits) | (a[i - 1] >> (32 - bits));
+  r[0] = a[0] << bits;
+  return out;
+}
+
+__attribute__((target("avx2"))) static void bigint_rshift_avx2(
+    uint32_t *r, const uint32_t *a, int n, int bits, uint32_t high) {
+  __m128i right = _mm_cvtsi32_si128(bits), left = _mm_cvtsi32_si128(32 - bits);
+  int i = 0;
+  for (; i + 9 <= n; i += 8) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(a + i + 1));
+    _mm256_storeu_si256((__m256i *)(r + i),
+                        _mm256_or_si256(_mm256_srl_epi32(lo, right),
+                                        _mm256_sll_epi32(hi, left)));
+  }
+  for (; i < n - 1; i++) r[i] = (a[i] >> bits) | (a[i + 1] << (32 - bits));
+  r[n - 1] = (a[n - 1] >> bits) | (high << (32 - bits));
+}
+
+// Radix 2^52 limbs for the IFMA kernels
+#define RADIX52_MASK ((UINT64_C(1) << 52) - 1)
+
+// Number of 52-bit limbs for n words, rounded up to whole 8-lane vectors
+static int radix52_limbs(int n) { return ((32 * n + 51) / 52 + 7) & ~7; }
+
+// d = a on m limbs of 52 bits, a on n words
+static void radix52_from_words(uint64_t *d, int m, const uint32_t *a, int n) {
+  unsigned __int128 acc = 0;
+  int bits = 0, j = 0;
+  for (int i = 0; i < n; i++) {
+    acc |= (unsigned __int128)a[i] << bits;
+    bits += 32;
+    if (bits >= 52) {
+      d[j++] = (uint64_t)acc & RADIX52_MASK;
+      acc >>= 52;
+      bits -= 52;
     }
-    if (i < b->size) {
-      tmp += b->digits[i];
+  }
+  if (bits) d[j++] = (uint64_t)acc;
+  while (j < m) d[j++] = 0;
+}
+
+// r = d on n words, d on m limbs of at most 52 bits
+static void radix52_to_words(uint32_t *r, int n, const uint64_t *d, int m) {
+  unsigned __int128 acc = 0;
+  int bits = 0, j = 0;
+  for (int i = 0; i < n; i++) {
+    while (bits < 32) {
+      acc |= (unsigned __int128)(j < m ? d[j++] : 0) << bits;
+      bits += 52;
     }
-    result->digits[result->size++] = (uint32_t)(tmp & 0xFFFFFFFF);
-    carry = tmp >> 32;
+    r[i] = (uint32_t)acc;
+    acc >>= 32;
+    bits -= 32;
   }
-  if (carry) {
-    result->digits[result->size++] = (uint32_t)carry;
+}
+
+// Carries the unreduced columns lo[k] + hi[k] into 52-bit limbs, d may be
+// lo and hi may be NULL. Returns the carry out of the top limb.
+static uint64_t radix52_normalize(uint64_t *d, const uint64_t *lo,
+                                  const uint64_t *hi, int len,
+                                  uint64_t carry) {
+  for (int k = 0; k < len; k++) {
+    unsigned __int128 v = (unsigned __int128)lo[k] + carry;
+    if (hi) v += hi[k];
+    d[k] = (uint64_t)v & RADIX52_MASK;
+    carry = (uint64_t)(v >> 52);
+  }
+  return carry;
+}
+
+// Largest operands of the IFMA product, in words
+#define IFMA_MUL_MAX_WORDS 64
+
+// r = a * b on an + bn words with an, bn <= IFMA_MUL_MAX_WORDS
+__attribute__((target("avx512f,avx512ifma"))) static void bigint_mul_ifma(
+    uint32_t *r, const uint32_t *a, int an, const uint32_t *b, int bn) {
+  enum { M = (32 * IFMA_MUL_MAX_WORDS + 51) / 52 + 8 };
+  // a behind 8 zero limbs so that blocks reading a[k - j] for j > k get zeros
+  uint64_t A[M + 16], B[M], lo[2 * M + 8], hi[2 * M + 8];
+  int ma = radix52_limbs(an), mb = (32 * bn + 51) / 52;
+  for (int i = 0; i < 8; i++) A[i] = 0;
+  radix52_from_words(A + 8, ma + 8, a, an);
+  radix52_from_words(B, mb, b, bn);
+
+  // Product scanning on blocks of 8 columns : column k gets the low halves
+  // of a[k - j] * b[j] in lo and the high halves in hi at column k + 1
+  hi[0] = 0;
+  for (int k = 0; k < ma + mb; k += 8) {
+    int first = k - ma + 1 > 0 ? k - ma + 1 : 0;
+    int last = k + 7 < mb - 1 ? k + 7 : mb - 1;
+    __m512i l0 = _mm512_setzero_si512(), h0 = l0, l1 = l0, h1 = l0;
+    int j = first;
+    for (; j + 1 <= last; j += 2) {
+      __m512i a0 = _mm512_loadu_si512(A + 8 + k - j);
+      __m512i a1 = _mm512_loadu_si512(A + 7 + k - j);
+      __m512i b0 = _mm512_set1_epi64(B[j]), b1 = _mm512_set1_epi64(B[j + 1]);
+      l0 = _mm512_madd52lo_epu64(l0, a0, b0);
+      h0 = _mm512_madd52hi_epu64(h0, a0, b0);
+      l1 = _mm512_madd52lo_epu64(l1, a1, b1);
+      h1 = _mm512_madd52hi_epu64(h1, a1, b1);
+    }
+    if (j <= last) {
+      __m512i a0 = _mm512_loadu_si512(A + 8 + k - j);
+      __m512i b0 = _mm512_set1_epi64(B[j]);
+      l0 = _mm512_madd52lo_epu64(l0, a0, b0);
+      h0 = _mm512_madd52hi_epu64(h0, a0, b0);
+    }
+    _mm512_storeu_si512(lo + k, _mm512_add_epi64(l0, l1));
+    _mm512_storeu_si512(hi + k + 1, _mm512_add_epi64(h0, h1));
+  }
+
+  radix52_normalize(lo, lo, hi, ma + mb, 0);
+  radix52_to_words(r, an + bn, lo, ma + mb);
+}
+
+// Largest modulus of the IFMA Montgomery product, in limbs, so that the
+// unreduced columns stay below 2^64
+#define IFMA_MONT_MAX_LIMBS 512
+
+// Word-by-word Montgomery product in radix 2^52 (Gueron and Krasnov 2016)
+// d = (a * b + q * n) / 2^(52m) < 2n on m + 1 limbs, with m a multiple of
+// 8 and n0 = -n^-1 mod 2^52. x is a scratch buffer of m + 8 limbs holding
+// the unreduced columns, shifted down one limb per step. No branch depends
+// on the operands.
+__attribute__((target("avx512f,avx512ifma"))) static void montgomery_ifma(
+    uint64_t *d, const uint64_t *a, const uint64_t *b, const uint64_t *n,
+    uint64_t n0, int m, uint64_t *x) {
+  memset(x, 0, sizeof(uint64_t) * (m + 8));
+
+  uint64_t carry = 0;
+  for (int i = 0; i < m; i++) {
+    // The low column is final once a * b[i] is added, q * n clears it
+    uint64_t col = x[0] + carry + ((a[0] * b[i]) & RADIX52_MASK);
+    uint64_t q = (col * n0) & RADIX52_MASK;
+    carry = (col + ((q * n[0]) & RADIX52_MASK)) >> 52;
+
+    // x = (x + low halves) / 2^52 + high halves
+    __m512i bi = _mm512_set1_epi64(b[i]), qv = _mm512_set1_epi64(q);
+    __m512i cur = _mm512_madd52lo_epu64(
+        _mm512_madd52lo_epu64(_mm512_loadu_si512(x), _mm512_loadu_si512(a),
+                              bi),
+        _mm512_loadu_si512(n), qv);
+    for (int v = 0; v < m; v += 8) {
+      __m512i next = _mm512_setzero_si512();
+      if (v + 8 < m)
+        next = _mm512_madd52lo_epu64(
+            _mm512_madd52lo_epu64(_mm512_loadu_si512(x + v + 8),
+                                  _mm512_loadu_si512(a + v + 8), bi),
+            _mm512_loadu_si512(n + v + 8), qv);
+      __m512i t = _mm512_alignr_epi64(next, cur, 1);
+      t = _mm512_madd52hi_epu64(t, _mm512_loadu_si512(a + v), bi);
+      t = _mm512_madd52hi_epu64(t, _mm512_loadu_si512(n + v), qv);
+      _mm512_storeu_si512(x + v, t);
+      cur = next;
+    }
+  }
+
+  d[m] = radix52_normalize(d, x, NULL, m, carry);
+}
+#endif
+
+// Kernel selection
+
+static uint32_t bigint_add_n(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                             int n) {
+#ifdef BIGINT_SIMD_X86
+  if (n >= 8 && bigint_simd_level() >= BIGINT_SIMD_AVX2)
+    return bigint_add_n_avx2(r, a, b, n);
+#endif
+  return bigint_add_n_scalar(r, a, b, n);
+}
+
+static uint32_t bigint_sub_n(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                             int n) {
+#ifdef BIGINT_SIMD_X86
+  if (n >= 8 && bigint_simd_level() >= BIGINT_SIMD_AVX2)
+    return bigint_sub_n_avx2(r, a, b, n);
+#endif
+  return bigint_sub_n_scalar(r, a, b, n);
+}
+
+static uint32_t bigint_lshift(uint32_t *r, const uint32_t *a, int n,
+                              int bits) {
+#ifdef BIGINT_SIMD_X86
+  if (n >= 16 && bigint_simd_level() >= BIGINT_SIMD_AVX2)
+    return bigint_lshift_avx2(r, a, n, bits);
+#endif
+  return bigint_lshift_scalar(r, a, n, bits);
+}
+
+static void bigint_rshift(uint32_t *r, const uint32_t *a, int n, int bits,
+                          uint32_t high) {
+#ifdef BIGINT_SIMD_X86
+  if (n >= 16 && bigint_simd_level() >= BIGINT_SIMD_AVX2) {
+    bigint_rshift_avx2(r, a, n, bits, high);
+    return;
   }
-  if (result->size > result->capacity) {
-    result->capacity = result->size;
-    result->digits =
-        realloc(result->digits, result->capacity * sizeof(uint32_t));
+#endif
+  bigint_rshift_scalar(r, a, n, bits, high);
+}
+
+BigInt *bigint_add(const BigInt *a, const BigInt *b) {
+#ifdef BIGINT_GMP
+  return bigint_gmp_binary(mpz_add, a, b);
+#endif
+  if (a->size < b->size) {
+    const BigInt *tmp = a;
+    a = b;
+    b = tmp;
+  }
+  int maxSize = a->size;
+  BigInt *result = calloc(1, sizeof(BigInt));
+  result->capacity = maxSize + 1;
+  result->digits = calloc(result->capacity, sizeof(uint32_t));
+  uint64_t carry = bigint_add_n(result->digits, a->digits, b->digits, b->size);
+  for (int i = b->size; i < maxSize; i++) {
+    uint64_t tmp = (uint64_t)a->digits[i] + carry;
+    result->digits[i] = (uint32_t)tmp;
+    carry = tmp >> 32;
   }
+  result->digits[maxSize] = (uint32_t)carry;
+  result->size = maxSize + 1;
   while (result->size > 1 && result->digits[result->size - 1] == 0) {
     result->size--;
   }
@@ -183,7 +862,7 @@ BigInt *bigint_subarray(const BigInt *a, int s, int l) {
   int start = s >= 0 ? s : 0;
   int length = (start + l > a->size) ? a->size - start : l;
 
-  BigInt *sub = malloc(sizeof(BigInt));
+  BigInt *sub = calloc(1, sizeof(BigInt));
   sub->size = length;
   sub->capacity = length;
   sub->digits = calloc(sub->capacity, sizeof(uint32_t));
@@ -197,29 +876,22 @@ BigInt *bigint_subarray(const BigInt *a, int s, int l) {
 
 // Returns a - b assuming a >= b
 BigInt *bigint_sub(const BigInt *a, const BigInt *b) {
-  BigInt *result = malloc(sizeof(BigInt));
+#ifdef BIGINT_GMP
+  return bigint_gmp_binary(mpz_sub, a, b);
+#endif
+  BigInt *result = calloc(1, sizeof(BigInt));
   result->capacity = a->capacity;
   result->digits = calloc(result->capacity, sizeof(uint32_t));
 
-  uint64_t borrow = 0;
-  int i = 0;
-  while (i < a->size) {
-    uint64_t ai = a->digits[i];
-    uint64_t bi = (i < b->size) ? b->digits[i] : 0;
-    uint64_t temp = ai - bi - borrow;
-
-    if (ai < bi + borrow) {
-      borrow = 1;
-      temp += ((uint64_t)1 << 32);  // add 2^32 if underflow
-    } else {
-      borrow = 0;
-    }
-
-    result->digits[i] = (uint32_t)(temp & 0xFFFFFFFF);
-    i++;
+  int bn = b->size < a->size ? b->size : a->size;
+  uint64_t borrow = bigint_sub_n(result->digits, a->digits, b->digits, bn);
+  for (int i = bn; i < a->size; i++) {
+    uint64_t temp = (uint64_t)a->digits[i] - borrow;
+    result->digits[i] = (uint32_t)temp;
+    borrow = (temp >> 32) & 1;
   }
 
-  result->size = i;
+  result->size = a->size;
   bigint_trim(result);
 
   if (result->size < result->capacity) {
@@ -236,19 +908,18 @@ BigInt *bigint_shift_left(const BigInt *a, int shift) {
   int shift_bits = shift % 32;
 
   int new_size = a->size + shift_words + (shift_bits ? 1 : 0);
-  BigInt *result = malloc(sizeof(BigInt));
+  BigInt *result = calloc(1, sizeof(BigInt));
   result->size = new_size;
   result->capacity = new_size;
   result->digits = calloc(result->capacity, sizeof(uint32_t));
 
-  for (int i = 0; i < a->size; i++) {
-    int new_pos = i + shift_words;
-    result->digits[new_pos] = a->digits[i] << shift_bits;
-
-    if (shift_bits && new_pos + 1 < new_size) {
-      result->digits[new_pos + 1] |= a->digits[i] >> (32 - shift_bits);
-    }
-  }
+  if (shift_bits)
+    result->digits[new_size - 1] =
+        bigint_lshift(result->digits + shift_words, a->digits, a->size,
+                      shift_bits);
+  else
+    memcpy(result->digits + shift_words, a->digits,
+           sizeof(uint32_t) * a->size);
 
   bigint_trim(result);
   return result;
@@ -267,11 +938,15 @@ BigInt *bigint_small_mul(uint32_t a, uint32_t b) {
   return res;
 }
 
+// Compares magnitudes, leading zero words are ignored
 int bigint_cmp(const BigInt *a, const BigInt *b) {
-  if (a->size > b->size) return 1;
-  if (a->size < b->size) return -1;
+  int an = a->size, bn = b->size;
+  while (an > 1 && a->digits[an - 1] == 0) an--;
+  while (bn > 1 && b->digits[bn - 1] == 0) bn--;
+  if (an > bn) return 1;
+  if (an < bn) return -1;
 
-  for (int i = a->size - 1; i >= 0; i--) {
+  for (int i = an - 1; i >= 0; i--) {
     if (a->digits[i] > b->digits[i]) return 1;
     if (a->digits[i] < b->digits[i]) return -1;
   }
@@ -288,59 +963,346 @@ int bigint_cmp_small(const BigInt *a, uint32_t b) {
   return 0;
 }
 
+// Below this many words, products use the schoolbook algorithm
+#define KARATSUBA_THRESHOLD 32
+
+// From this many words of the smaller operand, schoolbook products use the
+// IFMA kernel when available, which also moves the Karatsuba threshold up
+#define IFMA_MUL_THRESHOLD 16
+#define IFMA_KARATSUBA_THRESHOLD 64
+
+static int bigint_karatsuba_threshold() {
+#ifdef BIGINT_SIMD_X86
+  if (bigint_simd_level() >= BIGINT_SIMD_IFMA) return IFMA_KARATSUBA_THRESHOLD;
+#endif
+  return KARATSUBA_THRESHOLD;
+}
+
+static void bigint_add_words(uint32_t *r, int len, const uint32_t *a, int n);
+
+// r = a * b on an + bn words (schoolbook)
+static void bigint_mul_basecase(uint32_t *r, const uint32_t *a, int an,
+                                const uint32_t *b, int bn) {
+#ifdef BIGINT_SIMD_X86
+  if (bn >= IFMA_MUL_THRESHOLD && bn <= IFMA_MUL_MAX_WORDS &&
+      bigint_simd_level() >= BIGINT_SIMD_IFMA) {
+    // Chunks of a against the whole of b
+    uint32_t prod[2 * IFMA_MUL_MAX_WORDS];
+    memset(r, 0, sizeof(uint32_t) * (an + bn));
+    for (int i = 0; i < an; i += IFMA_MUL_MAX_WORDS) {
+      int len = an - i < IFMA_MUL_MAX_WORDS ? an - i : IFMA_MUL_MAX_WORDS;
+      bigint_mul_ifma(prod, a + i, len, b, bn);
+      bigint_add_words(r + i, an + bn - i, prod, len + bn);
+    }
+    return;
+  }
+#endif
+  memset(r, 0, sizeof(uint32_t) * (an + bn));
+  for (int i = 0; i < bn; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < an; j++) {
+      uint64_t sum = (uint64_t)a[j] * b[i] + r[i + j] + carry;
+      r[i + j] = (uint32_t)sum;
+      carry = sum >> 32;
+    }
+    r[i + an] = (uint32_t)carry;
+  }
+}
+
+// r += a on n words from r, propagating the carry up to r + len
+static void bigint_add_words(uint32_t *r, int len, const uint32_t *a, int n) {
+  uint64_t carry = bigint_add_n(r, r, a, n);
+  int i = n;
+  for (; carry && i < len; i++) {
+    uint64_t sum = (uint64_t)r[i] + carry;
+    r[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+}
+
+// r -= a on n words from r, propagating the borrow up to r + len
+static void bigint_sub_words(uint32_t *r, int len, const uint32_t *a, int n) {
+  uint64_t borrow = bigint_sub_n(r, r, a, n);
+  int i = n;
+  for (; borrow && i < len; i++) {
+    uint64_t diff = (uint64_t)r[i] - borrow;
+    r[i] = (uint32_t)diff;
+    borrow = (diff >> 32) ? 1 : 0;
+  }
+}
+
+// Work-stealing pool for the top levels of large products. Each worker owns
+// a deque of tasks : it pushes and pops at the bottom while idle workers
+// steal from the top. A thread waiting on a task runs other tasks meanwhile.
+// BIGINT_THREADS in the environment sets the number of threads, callers
+// included, the default being one per online processor.
+#define BIGINT_MAX_THREADS 64
+#define BIGINT_DEQUE_SIZE 256
+
+typedef struct bigint_task {
+  void (*run)(struct bigint_task *);
+  atomic_int done;
+} bigint_task;
+
+typedef struct {
+  pthread_mutex_t lock;
+  bigint_task *tasks[BIGINT_DEQUE_SIZE];
+  int top, bottom;  // Tasks in [top, bottom)
+} bigint_deque;
+
+static struct {
+  int threads;
+  // One deque per worker, the last one shared by threads outside the pool
+  bigint_deque deques[BIGINT_MAX_THREADS + 1];
+  atomic_int pending;  // Tasks pushed and not started yet
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+} bigint_pool;
+
+static pthread_once_t bigint_pool_once = PTHREAD_ONCE_INIT;
+static __thread int bigint_worker = -1;
+
+static bool bigint_deque_push(bigint_deque *d, bigint_task *t) {
+  pthread_mutex_lock(&d->lock);
+  bool pushed = d->bottom - d->top < BIGINT_DEQUE_SIZE;
+  if (pushed) d->tasks[d->bottom++ % BIGINT_DEQUE_SIZE] = t;
+  pthread_mutex_unlock(&d->lock);
+  return pushed;
+}
+
+// Newest task, from the owner
+static bigint_task *bigint_deque_pop(bigint_deque *d) {
+  bigint_task *t = NULL;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top) t = d->tasks[--d->bottom % BIGINT_DEQUE_SIZE];
+  if (d->bottom == d->top) d->top = d->bottom = 0;
+  pthread_mutex_unlock(&d->lock);
+  return t;
+}
+
+// Oldest task, hence the largest one, from a thief
+static bigint_task *bigint_deque_steal(bigint_deque *d) {
+  bigint_task *t = NULL;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top) t = d->tasks[d->top++ % BIGINT_DEQUE_SIZE];
+  if (d->bottom == d->top) d->top = d->bottom = 0;
+  pthread_mutex_unlock(&d->lock);
+  return t;
+}
+
+static bigint_deque *bigint_own_deque() {
+  return &bigint_pool.deques[bigint_worker >= 0 ? bigint_worker
+                                                 : BIGINT_MAX_THREADS];
+}
+
+// Own task first, else one stolen from another deque
+static bigint_task *bigint_pool_find() {
+  bigint_deque *own = bigint_own_deque();
+  bigint_task *t = bigint_deque_pop(own);
+  int workers = bigint_pool.threads - 1;
+  for (int i = 0; !t && i <= workers; i++) {
+    bigint_deque *victim =
+        &bigint_pool.deques[i < workers ? i : BIGINT_MAX_THREADS];
+    if (victim != own) t = bigint_deque_steal(victim);
+  }
+  return t;
+}
+
+static void bigint_task_run(bigint_task *t) {
+  atomic_fetch_sub(&bigint_pool.pending, 1);
+  t->run(t);
+  atomic_store(&t->done, 1);
+}
+
+static void *bigint_pool_worker(void *arg) {
+  bigint_worker = (int)(intptr_t)arg;
+  for (;;) {
+    bigint_task *t = bigint_pool_find();
+    if (t) {
+      bigint_task_run(t);
+      continue;
+    }
+    pthread_mutex_lock(&bigint_pool.lock);
+    while (atomic_load(&bigint_pool.pending) <= 0)
+      pthread_cond_wait(&bigint_pool.wake, &bigint_pool.lock);
+    pthread_mutex_unlock(&bigint_pool.lock);
+  }
+  return NULL;
+}
+
+static void bigint_pool_init() {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *env = getenv("BIGINT_THREADS");
+  int threads = env ? atoi(env) : (int)cpus;
+  if (threads < 1) threads = 1;
+  if (threads > BIGINT_MAX_THREADS + 1) threads = BIGINT_MAX_THREADS + 1;
+  bigint_pool.threads = threads;
+  atomic_init(&bigint_pool.pending, 0);
+  pthread_mutex_init(&bigint_pool.lock, NULL);
+  pthread_cond_init(&bigint_pool.wake, NULL);
+  for (int i = 0; i <= BIGINT_MAX_THREADS; i++)
+    pthread_mutex_init(&bigint_pool.deques[i].lock, NULL);
+
+  // Lazily initialized state read by the tasks
+  bigint_simd_level();
+
+  // The calling thread takes part, hence threads - 1 workers
+  for (int i = 0; i < threads - 1; i++) {
+    pthread_t thread;
+    pthread_create(&thread, NULL, bigint_pool_worker, (void *)(intptr_t)i);
+    pthread_detach(thread);
+  }
+}
+
+int bigint_pool_threads() {
+  pthread_once(&bigint_pool_once, bigint_pool_init);
+  return bigint_pool.threads;
+}
+
+// Queues t for the pool, or runs it right away if the pool is sequential or
+// the deque is full
+static void bigint_task_spawn(bigint_task *t) {
+  atomic_store(&t->done, 0);
+  if (bigint_pool_threads() > 1) {
+    atomic_fetch_add(&bigint_pool.pending, 1);
+    if (bigint_deque_push(bigint_own_deque(), t)) {
+      pthread_mutex_lock(&bigint_pool.lock);
+      pthread_cond_signal(&bigint_pool.wake);
+      pthread_mutex_unlock(&bigint_pool.lock);
+      return;
+    }
+    atomic_fetch_sub(&bigint_pool.pending, 1);
+  }
+  t->run(t);
+  atomic_store(&t->done, 1);
+}
+
+// Waits for t, running pending tasks in the meantime
+static void bigint_task_wait(bigint_task *t) {
+  while (!atomic_load(&t->done)) {
+    bigint_task *other = bigint_pool_find();
+    if (other)
+      bigint_task_run(other);
+    else
+      sched_yield();
+  }
+}
+
+// From this many words, the sub-products of a Karatsuba step run in parallel
+#define KARATSUBA_PARALLEL_THRESHOLD 1024
+
+static void bigint_karatsuba(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                             int n, uint32_t *ws);
+
+typedef struct {
+  bigint_task task;
+  uint32_t *r;
+  const uint32_t *a, *b;
+  int n;
+  uint32_t *ws;
+} bigint_karatsuba_task;
+
+static void bigint_karatsuba_run(bigint_task *t) {
+  bigint_karatsuba_task *k = (bigint_karatsuba_task *)t;
+  bigint_karatsuba(k->r, k->a, k->b, k->n, k->ws);
+}
+
+// r = a * b on 2n words (Karatsuba)
+// ws is a scratch buffer of at least 6n + 512 words
+static void bigint_karatsuba(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                             int n, uint32_t *ws) {
+  if (n < bigint_karatsuba_threshold()) {
+    bigint_mul_basecase(r, a, n, b, n);
+    return;
+  }
+
+  int h = n / 2;   // Low halves
+  int hh = n - h;  // High halves, hh >= h
+
+  // sa = a0 + a1, sb = b0 + b1 on hh + 1 words
+  uint32_t *sa = ws, *sb = ws + hh + 1, *z1 = ws + 2 * hh + 2;
+  memset(sa, 0, sizeof(uint32_t) * 2 * (hh + 1));
+  memcpy(sa, a + h, sizeof(uint32_t) * hh);
+  bigint_add_words(sa, hh + 1, a, h);
+  memcpy(sb, b + h, sizeof(uint32_t) * hh);
+  bigint_add_words(sb, hh + 1, b, h);
+
+  // z0 = a0 * b0, z2 = a1 * b1, z1 = sa * sb - z0 - z2
+  if (n >= KARATSUBA_PARALLEL_THRESHOLD && bigint_pool_threads() > 1) {
+    // z0 and z2 go to the pool with their own scratch, z1 is done here
+    uint32_t *ws2 = malloc(sizeof(uint32_t) * 2 * (6 * hh + 512));
+    bigint_karatsuba_task t0 = {.task.run = bigint_karatsuba_run, .r = r,
+                                .a = a, .b = b, .n = h, .ws = ws2};
+    bigint_karatsuba_task t2 = {.task.run = bigint_karatsuba_run,
+                                .r = r + 2 * h, .a = a + h, .b = b + h,
+                                .n = hh, .ws = ws2 + 6 * hh + 512};
+    bigint_task_spawn(&t0.task);
+    bigint_task_spawn(&t2.task);
+    bigint_karatsuba(z1, sa, sb, hh + 1, ws + 4 * hh + 4);
+    bigint_task_wait(&t2.task);
+    bigint_task_wait(&t0.task);
+    free(ws2);
+  } else {
+    bigint_karatsuba(r, a, b, h, ws + 4 * hh + 4);
+    bigint_karatsuba(r + 2 * h, a + h, b + h, hh, ws + 4 * hh + 4);
+    bigint_karatsuba(z1, sa, sb, hh + 1, ws + 4 * hh + 4);
+  }
+  bigint_sub_words(z1, 2 * hh + 2, r, 2 * h);
+  bigint_sub_words(z1, 2 * hh + 2, r + 2 * h, 2 * hh);
+
+  bigint_add_words(r + h, 2 * n - h, z1, 2 * hh + 2);
+}
+
+// r = a * b on an + bn words
+void bigint_mul_words(uint32_t *r, const uint32_t *a, int an, const uint32_t *b,
+                      int bn) {
+  if (an < bn) {
+    const uint32_t *tp = a;
+    a = b;
+    b = tp;
+    int tn = an;
+    an = bn;
+    bn = tn;
+  }
+  if (bn < bigint_karatsuba_threshold()) {
+    bigint_mul_basecase(r, a, an, b, bn);
+    return;
+  }
+
+  // Balanced bn x bn products over chunks of a
+  uint32_t *ws = malloc(sizeof(uint32_t) * (2 * bn + 6 * bn + 512));
+  uint32_t *prod = ws + 6 * bn + 512;
+  memset(r, 0, sizeof(uint32_t) * (an + bn));
+  int i = 0;
+  for (; i + bn <= an; i += bn) {
+    bigint_karatsuba(prod, a + i, b, bn, ws);
+    bigint_add_words(r + i, an + bn - i, prod, 2 * bn);
+  }
+  if (i < an) {
+    bigint_mul_words(prod, b, bn, a + i, an - i);
+    bigint_add_words(r + i, an + bn - i, prod, bn + an - i);
+  }
+  free(ws);
+}
+
 // Karatsuba multiplication
 BigInt *bigint_mul(const BigInt *a, const BigInt *b) {
+#ifdef BIGINT_GMP
+  return bigint_gmp_binary(mpz_mul, a, b);
+#endif
+  int an = a->size, bn = b->size;
+  while (an > 1 && a->digits[an - 1] == 0) an--;
+  while (bn > 1 && b->digits[bn - 1] == 0) bn--;
+
   // Zero if either is null
-  if ((a->size == 1 && a->digits[0] == 0) ||
-      (b->size == 1 && b->digits[0] == 0)) {
+  if ((an == 1 && a->digits[0] == 0) || (bn == 1 && b->digits[0] == 0)) {
     return bigint_init(0);
   }
 
-  // Base case
-  if (a->size == 1 && b->size == 1) {
-    return bigint_small_mul(a->digits[0], b->digits[0]);
-  }
-
-  // Divide both numbers into two halves
-  int m = (a->size > b->size ? a->size : b->size) / 2;  // Half size
-
-  // High and low parts
-  int a0_len = (m < a->size) ? m : a->size;
-  int a1_len = a->size - a0_len;
-  BigInt *a0 = bigint_subarray(a, 0, a0_len);
-  BigInt *a1 = bigint_subarray(a, a0_len, a1_len);
-  int b0_len = (m < b->size) ? m : b->size;
-  int b1_len = b->size - b0_len;
-  BigInt *b0 = bigint_subarray(b, 0, b0_len);
-  BigInt *b1 = bigint_subarray(b, b0_len, b1_len);
-
-  // Three products
-  BigInt *z0 = bigint_mul(a0, b0);
-  BigInt *aa = bigint_add(a1, a0);
-  bigint_free(a0);
-  BigInt *bb = bigint_add(b1, b0);
-  bigint_free(b0);
-  BigInt *z1 = bigint_mul(aa, bb);
-  bigint_free(aa);
-  bigint_free(bb);
-  BigInt *z2 = bigint_mul(a1, b1);
-  bigint_free(a1);
-  bigint_free(b1);
-  BigInt *temp1 = bigint_add(z2, z0);
-  BigInt *temp2 = bigint_sub(z1, temp1);
-  bigint_free(temp1);
-  bigint_free(z1);
-  BigInt *temp3 = bigint_shift_left(temp2, m * 32);
-  bigint_free(temp2);
-  BigInt *temp4 = bigint_shift_left(z2, 2 * m * 32);
-  bigint_free(z2);
-  BigInt *temp5 = bigint_add(temp3, temp4);
-  bigint_free(temp3);
-  bigint_free(temp4);
-  BigInt *result = bigint_add(temp5, z0);
-  bigint_free(z0);
-  bigint_free(temp5);
-
+  BigInt *result = bigint_init_size(an + bn);
+  bigint_mul_words(result->digits, a->digits, an, b->digits, bn);
+  result->size = an + bn;
+  bigint_trim(result);
   return result;
 }
 
@@ -360,6 +1322,21 @@ void bigint_sub_inplace(BigInt *a, const BigInt *b) {
   while (a->size > 1 && a->digits[a->size - 1] == 0) a->size--;
 }
 
+// a += b on magnitudes, grows a when needed
+void bigint_add_inplace(BigInt *a, const BigInt *b) {
+  int n = a->size > b->size ? a->size : b->size;
+  if (a->capacity < n + 1) bigint_resize(a, n + 1);
+  for (int i = a->size; i <= n; i++) a->digits[i] = 0;
+  uint64_t carry = bigint_add_n(a->digits, a->digits, b->digits, b->size);
+  for (int i = b->size; carry && i <= n; i++) {
+    uint64_t tmp = (uint64_t)a->digits[i] + carry;
+    a->digits[i] = (uint32_t)tmp;
+    carry = tmp >> 32;
+  }
+  a->size = n + 1;
+  while (a->size > 1 && a->digits[a->size - 1] == 0) a->size--;
+}
+
 // Adds a small value to a BigInt in place
 void bigint_add_small(BigInt *a, uint32_t value) {
   uint64_t carry = value;
@@ -388,155 +1365,634 @@ int bigint_bit_length(const BigInt *a) {
   return bits;
 }
 
-// Sub function used in mod
-void bigint_shift_left_one_bit_and_add(BigInt *r, int bit) {
-  uint32_t carry = bit;
-  for (size_t i = 0; i < r->size; ++i) {
-    uint64_t val = ((uint64_t)r->digits[i] << 1) | carry;
-    carry = (val >> 32) & 1;
-    r->digits[i] = (uint32_t)val;
-  }
-  if (carry) {
-    r->digits = realloc(r->digits, sizeof(uint32_t) * (r->size + 1));
-    r->digits[r->size] = 1;
-    r->size += 1;
+// Divides a by m using word-level long division (Knuth, TAOCP vol. 2,
+// 4.3.1, Algorithm D). Either of q and r may be NULL if not needed.
+void bigint_divmod(const BigInt *a, const BigInt *m, BigInt **q, BigInt **r) {
+#ifdef BIGINT_GMP
+  bigint_gmp_divmod(a, m, q, r);
+  return;
+#endif
+  int n = m->size;
+  while (n > 1 && m->digits[n - 1] == 0) n--;
+  int len = a->size;
+  while (len > 1 && a->digits[len - 1] == 0) len--;
+  assert(n > 1 || m->digits[0] != 0);
+
+  // a < m : quotient is zero
+  if (len < n) {
+    if (q) *q = bigint_init(0);
+    if (r) {
+      *r = bigint_copy(a);
+      bigint_trim(*r);
+    }
+    return;
   }
-}
 
-// Calculates a mod m using binary long division algorithm
-BigInt *bigint_mod(const BigInt *a, const BigInt *m) {
-  BigInt *r = bigint_init_size(m->size + 1);
-  int n = bigint_bit_length(a);
-  for (int i = n - 1; i >= 0; i--) {
-    int bit = (a->digits[i / 32] >> (i % 32)) & 1;
-    bigint_shift_left_one_bit_and_add(r, bit);
-
-    if (r->size >= m->size) {
-      if (bigint_cmp(r, m) >= 0) bigint_sub_inplace(r, m);
+  BigInt *quot = bigint_init_size(len - n + 1);
+  quot->size = len - n + 1;
+
+  // Single word divisor
+  if (n == 1) {
+    uint64_t d = m->digits[0];
+    uint64_t rem = 0;
+    for (int i = len - 1; i >= 0; i--) {
+      uint64_t cur = (rem << 32) | a->digits[i];
+      quot->digits[i] = (uint32_t)(cur / d);
+      rem = cur % d;
+    }
+    bigint_trim(quot);
+    if (q)
+      *q = quot;
+    else
+      bigint_free(quot);
+    if (r) *r = bigint_init((uint32_t)rem);
+    return;
+  }
+
+  // Normalize so that the top word of the divisor has its high bit set
+  int s = __builtin_clz(m->digits[n - 1]);
+  uint32_t *vn = malloc(sizeof(uint32_t) * n);
+  uint32_t *un = malloc(sizeof(uint32_t) * (len + 1));
+  if (s) {
+    bigint_lshift(vn, m->digits, n, s);
+    un[len] = bigint_lshift(un, a->digits, len, s);
+  } else {
+    memcpy(vn, m->digits, sizeof(uint32_t) * n);
+    memcpy(un, a->digits, sizeof(uint32_t) * len);
+    un[len] = 0;
+  }
+
+  for (int j = len - n; j >= 0; j--) {
+    // Estimate the quotient word from the top two words
+    uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+    uint64_t qhat = num / vn[n - 1];
+    uint64_t rhat = num % vn[n - 1];
+    while (qhat > 0xFFFFFFFF ||
+           qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat > 0xFFFFFFFF) break;
     }
+
+    // Multiply and subtract
+    int64_t t;
+    uint64_t borrow = 0;
+    for (int i = 0; i < n; i++) {
+      uint64_t p = qhat * vn[i];
+      t = (int64_t)un[i + j] - (int64_t)borrow - (int64_t)(p & 0xFFFFFFFF);
+      un[i + j] = (uint32_t)t;
+      borrow = (p >> 32) - (t >> 32);
+    }
+    t = (int64_t)un[j + n] - (int64_t)borrow;
+    un[j + n] = (uint32_t)t;
+
+    // qhat was one too large : add back
+    if (t < 0) {
+      qhat--;
+      un[j + n] += bigint_add_n(un + j, un + j, vn, n);
+    }
+    quot->digits[j] = (uint32_t)qhat;
   }
 
-  bigint_trim(r);
+  bigint_trim(quot);
+  if (q)
+    *q = quot;
+  else
+    bigint_free(quot);
+
+  // Unnormalize the remainder
+  if (r) {
+    BigInt *rem = bigint_init_size(n);
+    rem->size = n;
+    if (s)
+      bigint_rshift(rem->digits, un, n, s, un[n]);
+    else
+      memcpy(rem->digits, un, sizeof(uint32_t) * n);
+    bigint_trim(rem);
+    *r = rem;
+  }
+
+  free(vn);
+  free(un);
+}
+
+// Calculates a mod m
+BigInt *bigint_mod(const BigInt *a, const BigInt *m) {
+  BigInt *r;
+  bigint_divmod(a, m, NULL, &r);
   return r;
 }
 
+// Calculates a mod d for a single word d
+uint32_t bigint_mod_small(const BigInt *a, uint32_t d) {
+  assert(d != 0);
+#ifdef BIGINT_GMP
+  return bigint_gmp_mod_small(a, d);
+#endif
+  uint64_t rem = 0;
+  for (int i = a->size - 1; i >= 0; i--)
+    rem = ((rem << 32) | a->digits[i]) % d;
+  return (uint32_t)rem;
+}
+
 BigInt *bigint_random(int num_blocks) {
-  BigInt *num = malloc(sizeof(BigInt));
+  BigInt *num = calloc(1, sizeof(BigInt));
   num->capacity = num_blocks;
   num->size = num_blocks;
   num->digits = malloc(sizeof(uint32_t) * num_blocks);
 
-  int fd = open("/dev/urandom", O_RDONLY);
-  if (fd < 0) {
-    perror("open /dev/urandom");
-    exit(EXIT_FAILURE);
-  }
-
-  ssize_t expected_bytes = sizeof(uint32_t) * num_blocks;
-  ssize_t read_bytes = read(fd, num->digits, expected_bytes);
-  if (read_bytes != expected_bytes) {
-    perror("read /dev/urandom");
-    close(fd);
-    bigint_free(num);
-    exit(EXIT_FAILURE);
+  // getrandom saves opening /dev/urandom on every call
+  size_t expected_bytes = sizeof(uint32_t) * num_blocks;
+  uint8_t *buf = (uint8_t *)num->digits;
+  while (expected_bytes > 0) {
+    ssize_t read_bytes = getrandom(buf, expected_bytes, 0);
+    if (read_bytes < 0) {
+      if (errno == EINTR) continue;
+      perror("getrandom");
+      bigint_free(num);
+      exit(EXIT_FAILURE);
+    }
+    buf += read_bytes;
+    expected_bytes -= read_bytes;
   }
 
-  close(fd);
   while (num->size > 1 && num->digits[num->size - 1] == 0) num->size--;
   return num;
 }
 
+// Uniform random BigInt in [0, bound[
+BigInt *bigint_random_below(const BigInt *bound) {
+  assert(!bigint_is_zero(bound));
+  int size = bound->size;
+  int bits = bigint_bit_length(bound);
+  uint32_t mask = (bits % 32) ? (1u << (bits % 32)) - 1 : 0xFFFFFFFF;
+  for (;;) {
+    BigInt *num = bigint_random(size);
+    num->size = size;
+    num->digits[size - 1] &= mask;
+    bigint_trim(num);
+    if (bigint_cmp(num, bound) < 0) return num;
+    bigint_free(num);
+  }
+}
+
 // Generates a random BigInt between min and max (exclusive)
 BigInt *bigint_random_range(const BigInt *min, const BigInt *max) {
   assert(bigint_cmp(min, max) < 0);
   int size = max->size;
   int bits = bigint_bit_length(max);
+  uint32_t mask = (bits % 32) ? (1u << (bits % 32)) - 1 : 0xFFFFFFFF;
   BigInt *num = bigint_random(size);
-  num->digits[size - 1] &=
-      (1u << (bits % 32)) - 1;  // Set the last bits to zero
+  num->size = size;
+  num->digits[size - 1] &= mask;  // Set the last bits to zero
+  bigint_trim(num);
 
   while (bigint_cmp(num, min) <= 0 || bigint_cmp(num, max) >= 0) {
     bigint_free(num);
     num = bigint_random(size);
-    num->digits[size - 1] &=
-        (1u << (bits % 32)) - 1;  // Set the last bits to zero
+    num->size = size;
+    num->digits[size - 1] &= mask;  // Set the last bits to zero
+    bigint_trim(num);
   }
   return num;
 }
 
+// r = a * b mod 2^(32k) on k words
+// Schoolbook on the low triangle, full Karatsuba product for large k
+void bigint_mul_low_words(uint32_t *r, const uint32_t *a, int an,
+                          const uint32_t *b, int bn, int k) {
+  if (an > k) an = k;
+  if (bn > k) bn = k;
+
+  if (an >= KARATSUBA_THRESHOLD && bn >= KARATSUBA_THRESHOLD) {
+    uint32_t *prod = malloc(sizeof(uint32_t) * (an + bn));
+    bigint_mul_words(prod, a, an, b, bn);
+    int len = (an + bn < k) ? an + bn : k;
+    memcpy(r, prod, sizeof(uint32_t) * len);
+    memset(r + len, 0, sizeof(uint32_t) * (k - len));
+    free(prod);
+    return;
+  }
+
+  memset(r, 0, sizeof(uint32_t) * k);
+  for (int i = 0; i < an; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < bn && (i + j) < k; j++) {
+      uint64_t sum = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+      r[i + j] = (uint32_t)sum;
+      carry = sum >> 32;
+    }
+    if (i + bn < k) r[i + bn] = (uint32_t)carry;
+  }
+}
+
 // Multiplies a * b and keeps only the k_bits least significant bits
 BigInt *bigint_mul_low(const BigInt *a, const BigInt *b, int k_bits) {
+#ifdef BIGINT_GMP
+  return bigint_gmp_mul_low(a, b, k_bits);
+#endif
   int k_words = (k_bits + 31) / 32;
   BigInt *result = bigint_init_size(k_words);
-  uint64_t carry = 0;
+  bigint_mul_low_words(result->digits, a->digits, a->size, b->digits, b->size,
+                       k_words);
+  if (k_bits % 32) result->digits[k_words - 1] &= (1u << (k_bits % 32)) - 1;
+  result->size = k_words;
+  bigint_trim(result);
+  return result;
+}
 
-  for (int i = 0; i < a->size; i++) {
-    carry = 0;
-    for (int j = 0; j < b->size && (i + j) < k_words; j++) {
-      uint64_t mul = (uint64_t)a->digits[i] * b->digits[j];
-      uint64_t sum = (uint64_t)result->digits[i + j] + mul + carry;
-
-      // Low part to result
-      result->digits[i + j] = (uint32_t)sum;
-      // High part to carry
-      carry = sum >> 32;
+// Calculates floor(b^(2k) / m) for m on k >= 2 words by Newton iteration
+// x = x + x * (b^(2k) - m * x) / b^(2k), from a 32-bit seed and from below,
+// so that the cost is a few products instead of a quadratic division
+static BigInt *bigint_reciprocal(const BigInt *m) {
+  int k = m->size;
+  BigInt *b2k = bigint_init_size(2 * k + 1);
+  b2k->digits[2 * k] = 1;
+  b2k->size = 2 * k + 1;
+
+  // Seed from the top two words of m, below b^(2k) / m
+  uint64_t top = ((uint64_t)m->digits[k - 1] << 32) | m->digits[k - 2];
+  unsigned __int128 seed = ~(unsigned __int128)0 / ((unsigned __int128)top + 1);
+  BigInt *x = bigint_init_size(k + 2);
+  for (int i = 0; i < 4; i++)
+    x->digits[k - 2 + i] = (uint32_t)(seed >> (32 * i));
+  x->size = k + 2;
+  bigint_trim(x);
+
+  // The number of correct bits doubles at each step
+  for (int bits = 32; bits < 64 * k; bits *= 2) {
+    BigInt *mx = bigint_mul(m, x);
+    BigInt *e = bigint_sub(b2k, mx);
+    BigInt *xe = bigint_mul(x, e);
+    bigint_free(mx);
+    bigint_free(e);
+    if (xe->size <= 2 * k) {
+      bigint_free(xe);
+      break;
     }
+    BigInt *d = bigint_subarray(xe, 2 * k, xe->size - 2 * k);
+    bigint_add_inplace(x, d);
+    bool done = bigint_is_zero(d);
+    bigint_free(xe);
+    bigint_free(d);
+    if (done) break;
+  }
+
+  // A few final corrections : b^(2k) - m * x < m
+  BigInt *mx = bigint_mul(m, x);
+  BigInt *rem = bigint_sub(b2k, mx);
+  while (bigint_cmp(rem, m) >= 0) {
+    bigint_sub_inplace(rem, m);
+    bigint_add_small(x, 1);
+  }
+  bigint_free(mx);
+  bigint_free(rem);
+  bigint_free(b2k);
+  return x;
+}
 
-    // Add carry to next word
-    if ((i + b->size) < k_words) result->digits[i + b->size] += (uint32_t)carry;
+// Below this size the reciprocal comes from long division
+#define BARRETT_NEWTON_THRESHOLD 32
+
+bigint_barrett_ctx *bigint_barrett_init(const BigInt *m) {
+  bigint_barrett_ctx *ctx = malloc(sizeof(bigint_barrett_ctx));
+  ctx->m = bigint_copy(m);
+  bigint_trim(ctx->m);
+  ctx->m->negative = false;
+  ctx->k = ctx->m->size;
+
+  if (ctx->k >= BARRETT_NEWTON_THRESHOLD) {
+    ctx->mu = bigint_reciprocal(ctx->m);
+    return ctx;
+  }
+  BigInt *b2k = bigint_init_size(2 * ctx->k + 1);
+  b2k->digits[2 * ctx->k] = 1;
+  b2k->size = 2 * ctx->k + 1;
+  bigint_divmod(b2k, ctx->m, &ctx->mu, NULL);
+  bigint_free(b2k);
+  return ctx;
+}
+
+void bigint_barrett_free(bigint_barrett_ctx *ctx) {
+  bigint_free(ctx->m);
+  bigint_free(ctx->mu);
+  free(ctx);
+}
+
+// Calculates a mod m with the precomputed reciprocal (HAC, Algorithm 14.42)
+BigInt *bigint_barrett_reduce(const BigInt *a, const bigint_barrett_ctx *ctx) {
+  BigInt *r;
+  bigint_barrett_divmod(a, ctx, NULL, &r);
+  return r;
+}
+
+// Quotient and remainder of |a| by the context modulus, same contract as
+// bigint_divmod
+void bigint_barrett_divmod(const BigInt *a, const bigint_barrett_ctx *ctx,
+                           BigInt **q, BigInt **r) {
+#ifdef BIGINT_GMP
+  bigint_divmod(a, ctx->m, q, r);
+  return;
+#endif
+  int k = ctx->k;
+  int len = a->size;
+  while (len > 1 && a->digits[len - 1] == 0) len--;
+
+  // Out of range for the reciprocal : fall back to long division
+  if (len > 2 * k) {
+    bigint_divmod(a, ctx->m, q, r);
+    return;
+  }
+  if (len < k) {
+    if (q) *q = bigint_init(0);
+    if (r) {
+      *r = bigint_copy(a);
+      (*r)->negative = false;
+      bigint_trim(*r);
+    }
+    return;
   }
 
-  bigint_resize(result, k_words);
-  result->size = k_words;
-  bigint_trim(result);
-  return result;
+  // q3 = floor(floor(a / b^(k-1)) * mu / b^(k+1))
+  BigInt *q1 = bigint_subarray(a, k - 1, len - k + 1);
+  BigInt *q2 = bigint_mul(q1, ctx->mu);
+  BigInt *q3 = (q2->size > k + 1) ? bigint_subarray(q2, k + 1, q2->size - k - 1)
+                                  : bigint_init(0);
+
+  // r = (a - q3 * m) mod b^(k+1)
+  BigInt *r2 = bigint_mul_low(q3, ctx->m, 32 * (k + 1));
+  BigInt *rem = bigint_init_size(k + 1);
+  rem->size = k + 1;
+  uint64_t borrow = 0;
+  for (int i = 0; i < k + 1; i++) {
+    uint64_t ai = (i < len) ? a->digits[i] : 0;
+    uint64_t bi = (i < r2->size) ? r2->digits[i] : 0;
+    uint64_t diff = ai - bi - borrow;
+    rem->digits[i] = (uint32_t)diff;
+    borrow = (diff >> 32) ? 1 : 0;
+  }
+  bigint_trim(rem);
+
+  // At most two corrections are needed
+  while (bigint_cmp(rem, ctx->m) >= 0) {
+    bigint_sub_inplace(rem, ctx->m);
+    bigint_add_small(q3, 1);
+  }
+
+  bigint_free(q1);
+  bigint_free(q2);
+  bigint_free(r2);
+  if (q) *q = q3;
+  else bigint_free(q3);
+  if (r) *r = rem;
+  else bigint_free(rem);
 }
 
-// Calculates the modular inverse of m modulo 2^k
+// Decimal conversions split the numbers around the powers 10^(9 * 2^i),
+// kept with their Barrett contexts : O(M(n) log n) instead of quadratic.
+// Below DEC_THRESHOLD_WORDS words, chunks of 9 digits one word at a time.
+#define DEC_CHUNK 1000000000u
+#define DEC_CHUNK_DIGITS 9
+#define DEC_THRESHOLD_WORDS 32
+#define DEC_MAX_POWERS 32
+
+static struct {
+  BigInt *pow[DEC_MAX_POWERS];  // 10^(9 * 2^i)
+  bigint_barrett_ctx *ctx[DEC_MAX_POWERS];
+  int count;
+  pthread_mutex_t lock;
+} dec_powers = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+// Makes dec_powers.pow[level] available, computing the missing powers by
+// squaring, and returns level. Published powers never change and are
+// shared by all the threads.
+static int dec_power(int level) {
+  assert(level < DEC_MAX_POWERS);
+  pthread_mutex_lock(&dec_powers.lock);
+  if (dec_powers.count == 0) {
+    dec_powers.pow[0] = bigint_init(DEC_CHUNK);
+    dec_powers.ctx[0] = bigint_barrett_init(dec_powers.pow[0]);
+    dec_powers.count = 1;
+  }
+  while (dec_powers.count <= level) {
+    int i = dec_powers.count;
+    BigInt *prev = dec_powers.pow[i - 1];
+    dec_powers.pow[i] = bigint_mul(prev, prev);
+    dec_powers.ctx[i] = bigint_barrett_init(dec_powers.pow[i]);
+    dec_powers.count++;
+  }
+  pthread_mutex_unlock(&dec_powers.lock);
+  return level;
+}
+
+// Writes |x| on exactly width digits, zero-padded, by divisions by 10^9
+static void dec_print_basecase(char *out, int width, const BigInt *x) {
+  int n = x->size;
+  uint32_t *w = malloc(sizeof(uint32_t) * n);
+  memcpy(w, x->digits, sizeof(uint32_t) * n);
+  while (n > 1 && w[n - 1] == 0) n--;
+  int pos = width;
+  while (pos > 0) {
+    uint64_t rem = 0;
+    for (int i = n - 1; i >= 0; i--) {
+      uint64_t cur = (rem << 32) | w[i];
+      w[i] = (uint32_t)(cur / DEC_CHUNK);
+      rem = cur % DEC_CHUNK;
+    }
+    while (n > 1 && w[n - 1] == 0) n--;
+    for (int d = 0; d < DEC_CHUNK_DIGITS && pos > 0; d++) {
+      out[--pos] = '0' + rem % 10;
+      rem /= 10;
+    }
+  }
+  free(w);
+}
+
+// x = q * 10^(9 * 2^i) + r, r written on the low 9 * 2^i digits
+static void dec_print_rec(char *out, int width, const BigInt *x) {
+  if (x->size <= DEC_THRESHOLD_WORDS) {
+    dec_print_basecase(out, width, x);
+    return;
+  }
+  // Smallest power with x < pow^2, for the Barrett reduction and a split
+  // in two halves
+  int i = 0;
+  while (2 * dec_powers.pow[dec_power(i)]->size < x->size) i++;
+  while (i > 0 && (DEC_CHUNK_DIGITS << i) >= width) i--;
+  int low = DEC_CHUNK_DIGITS << i;
+  if (low >= width) {
+    dec_print_basecase(out, width, x);
+    return;
+  }
+
+  BigInt *q, *r;
+  bigint_barrett_divmod(x, dec_powers.ctx[i], &q, &r);
+  dec_print_rec(out, width - low, q);
+  dec_print_rec(out + width - low, low, r);
+  bigint_free(q);
+  bigint_free(r);
+}
+
+// Decimal string of num, allocated with malloc
+char *bigint_to_dec(const BigInt *num) {
+#ifdef BIGINT_GMP
+  mpz_t z;
+  mpz_init(z);
+  bigint_to_mpz(z, num);
+  char *gmp_str = mpz_get_str(NULL, 10, z);
+  mpz_clear(z);
+  return gmp_str;
+#endif
+  // 32 * log10(2) < 9.64 digits per word
+  int width = num->size * 10 + 1;
+  char *str = malloc(width + 2);
+  char *digits = str + 1;
+  dec_print_rec(digits, width, num);
+  int skip = 0;
+  while (skip < width - 1 && digits[skip] == '0') skip++;
+  int sign = num->negative && !bigint_is_zero(num);
+  if (sign) str[0] = '-';
+  memmove(str + sign, digits + skip, width - skip);
+  str[sign + width - skip] = '\0';
+  return str;
+}
+
+// Parses len digits, x = hi * 10^(9 * 2^i) + lo with lo on 9 * 2^i digits
+static BigInt *dec_parse_rec(const char *s, int len) {
+  if (len <= DEC_THRESHOLD_WORDS * DEC_CHUNK_DIGITS) {
+    BigInt *x = bigint_init_size(len / DEC_CHUNK_DIGITS + 2);
+    x->size = 1;
+    int first = len % DEC_CHUNK_DIGITS ? len % DEC_CHUNK_DIGITS
+                                       : DEC_CHUNK_DIGITS;
+    for (int pos = 0; pos < len;) {
+      int n = (pos == 0) ? first : DEC_CHUNK_DIGITS;
+      uint64_t carry = 0, mul = 1;
+      for (int d = 0; d < n; d++) {
+        carry = carry * 10 + (s[pos++] - '0');
+        mul *= 10;
+      }
+      // x = x * 10^n + chunk
+      for (int i = 0; i < x->size; i++) {
+        uint64_t t = (uint64_t)x->digits[i] * mul + carry;
+        x->digits[i] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      if (carry) x->digits[x->size++] = (uint32_t)carry;
+    }
+    bigint_trim(x);
+    return x;
+  }
+
+  int i = 0;
+  while ((DEC_CHUNK_DIGITS << (i + 1)) < len) i++;
+  int low = DEC_CHUNK_DIGITS << i;
+  BigInt *hi = dec_parse_rec(s, len - low);
+  BigInt *lo = dec_parse_rec(s + len - low, low);
+  BigInt *x = bigint_mul(hi, dec_powers.pow[dec_power(i)]);
+  bigint_add_inplace(x, lo);
+  bigint_free(hi);
+  bigint_free(lo);
+  return x;
+}
+
+// Parses an optional '-' and decimal digits, *end set past the last digit
+static BigInt *dec_parse(const char *str, const char **end) {
+  while (isspace((unsigned char)*str)) str++;
+  bool negative = *str == '-';
+  if (negative || *str == '+') str++;
+  int len = 0;
+  while (isdigit((unsigned char)str[len])) len++;
+  if (end) *end = str + len;
+  if (len == 0) return bigint_init(0);
+#ifdef BIGINT_GMP
+  char *digits = strndup(str, len);
+  mpz_t z;
+  mpz_init_set_str(z, digits, 10);
+  if (negative) mpz_neg(z, z);
+  BigInt *gmp_x = bigint_from_mpz(z);
+  mpz_clear(z);
+  free(digits);
+  return gmp_x;
+#endif
+  BigInt *x = dec_parse_rec(str, len);
+  x->negative = negative && !bigint_is_zero(x);
+  return x;
+}
+
+BigInt *bigint_from_dec(const char *str) { return dec_parse(str, NULL); }
+
+// Hexadecimal string of num without prefix nor leading zeros, allocated
+// with malloc. Linear, as every digit only depends on its own word.
+char *bigint_to_hex(const BigInt *num) {
+  static const char hex[] = "0123456789abcdef";
+  int n = num->size;
+  while (n > 1 && num->digits[n - 1] == 0) n--;
+  char *str = malloc(8 * n + 2);
+  char *p = str;
+  if (num->negative && !bigint_is_zero(num)) *p++ = '-';
+  bool leading = true;
+  for (int i = 8 * n - 1; i >= 0; i--) {
+    int d = (num->digits[i / 8] >> (4 * (i % 8))) & 0xF;
+    if (leading && d == 0 && i > 0) continue;
+    leading = false;
+    *p++ = hex[d];
+  }
+  *p = '\0';
+  return str;
+}
+
+// Calculates a^-1 mod 2^64 for odd a (Newton iteration, two words)
+uint64_t bigint_inv_word64(uint64_t a) {
+  assert(a & 1);
+  uint64_t x = a;  // Inverse mod 8, precision doubles at each step
+  for (int i = 0; i < 5; i++) x *= 2 - a * x;
+  return x;
+}
+
+// Calculates the modular inverse of a modulo 2^k
+// Newton iteration x = x * (2 - a * x), doubling the number of correct
+// words from a two-word seed. Only the new high words are computed :
+// if a * x = 1 + e * 2^(32w), then x' = x - (x * e mod 2^(32w)) * 2^(32w)
 BigInt *bigint_modinv_pow2(const BigInt *a, int k) {
   assert(a->digits[0] & 1);
+#ifdef BIGINT_GMP
+  return bigint_gmp_modinv_pow2(a, k);
+#endif
   int words = (k + 31) / 32;
+  if (words < 2) words = 2;
 
-  BigInt *x = bigint_init_size(words);
-  x->digits[0] = 1;
-  x->size = 1;
+  // x on words words, t = a * x and u = x * e on 2 * words words
+  uint32_t *x = calloc(5 * words, sizeof(uint32_t));
+  uint32_t *t = x + words, *u = x + 3 * words;
 
-  for (int i = 1; i < k; i *= 2) {
-    BigInt *t = bigint_mul_low(a, x, 2 * i);
+  uint64_t seed = a->digits[0];
+  if (a->size > 1) seed |= (uint64_t)a->digits[1] << 32;
+  seed = bigint_inv_word64(seed);
+  x[0] = (uint32_t)seed;
+  x[1] = (uint32_t)(seed >> 32);
 
-    BigInt *two = bigint_init_size(words);
-    two->digits[0] = 2;
-    two->size = 1;
+  for (int w = 2; w < words; w *= 2) {
+    int w2 = (2 * w < words) ? 2 * w : words;
+    bigint_mul_low_words(t, a->digits, a->size, x, w, w2);
+    bigint_mul_low_words(u, x, w2 - w, t + w, w2 - w, w2 - w);
 
+    // x[w .. w2) = -u mod 2^(32 (w2 - w))
     uint64_t borrow = 0;
-    for (int j = 0; j < words; j++) {
-      uint64_t two_val = (j < two->size) ? two->digits[j] : 0;
-      uint64_t t_val = (j < t->size) ? t->digits[j] : 0;
-      uint64_t diff = two_val - t_val - borrow;
-
-      if (j < two->size) {
-        two->digits[j] = (uint32_t)diff;
-      } else {
-        if (diff != 0) {
-          bigint_resize(two, j + 1);
-          two->digits[j] = (uint32_t)diff;
-          two->size = j + 1;
-        }
-      }
+    for (int i = 0; i < w2 - w; i++) {
+      uint64_t diff = 0 - (uint64_t)u[i] - borrow;
+      x[w + i] = (uint32_t)diff;
       borrow = (diff >> 32) ? 1 : 0;
     }
-    bigint_free(t);
-
-    BigInt *new_x = bigint_mul_low(x, two, 2 * i);
-    bigint_free(two);
-    bigint_free(x);
-    x = new_x;
   }
 
-  BigInt *one = bigint_init(1);
-  BigInt *result = bigint_mul_low(x, one, k);
-  bigint_free(one);
-  bigint_free(x);
+  // Keep the k lowest bits
+  int k_words = (k + 31) / 32;
+  BigInt *result = bigint_init_size(k_words);
+  memcpy(result->digits, x, sizeof(uint32_t) * k_words);
+  if (k % 32) result->digits[k_words - 1] &= (1u << (k % 32)) - 1;
+  result->size = k_words;
+  bigint_trim(result);
+  free(x);
   return result;
 }
 
@@ -547,23 +2003,19 @@ BigInt *bigint_div_pow2(const BigInt *n, int shift) {
   int shift_words = shift / 32;
   int shift_bits = shift % 32;
   int new_size = n->size - shift_words;
+  if (new_size <= 0) return bigint_init(0);
 
-  BigInt *result = malloc(sizeof(BigInt));
+  BigInt *result = calloc(1, sizeof(BigInt));
   result->size = new_size;
   result->capacity = new_size;
   result->digits = calloc(result->capacity, sizeof(uint32_t));
 
-  for (int i = 0; i < new_size; i++) {
-    if (shift_bits == 0)
-      result->digits[i] = n->digits[i + shift_words] >> shift_bits;
-    else {
-      uint32_t low = n->digits[i + shift_words] >> shift_bits;
-      uint32_t high = (i + shift_words + 1 < n->size)
-                          ? n->digits[i + shift_words + 1] << (32 - shift_bits)
-                          : 0;
-      result->digits[i] = low | high;
-    }
-  }
+  if (shift_bits == 0)
+    memcpy(result->digits, n->digits + shift_words,
+           sizeof(uint32_t) * new_size);
+  else
+    bigint_rshift(result->digits, n->digits + shift_words, new_size,
+                  shift_bits, 0);
 
   bigint_trim(result);
   return result;
@@ -590,13 +2042,8 @@ void bigint_shift_left_inplace(BigInt *a, int shift) {
   a->size += shift_words;
   if (shift_bits == 0) return;
 
-  // Bit by bit
-  uint32_t carry = 0;
-  for (int i = shift_words; i < a->size; i++) {
-    uint32_t new_carry = a->digits[i] >> (32 - shift_bits);
-    a->digits[i] = (a->digits[i] << shift_bits) | carry;
-    carry = new_carry;
-  }
+  uint32_t carry = bigint_lshift(a->digits + shift_words, a->digits + shift_words,
+                                 a->size - shift_words, shift_bits);
 
   if (carry != 0) {
     if (a->size == a->capacity) {
@@ -607,6 +2054,113 @@ void bigint_shift_left_inplace(BigInt *a, int shift) {
   }
 }
 
+// Signed arithmetic
+
+// Sets the sign of a fresh result, zero staying non-negative
+static BigInt *bigint_signed_result(BigInt *a, bool negative) {
+  bigint_trim(a);
+  a->negative = negative && !bigint_is_zero(a);
+  return a;
+}
+
+BigInt *bigint_from_int(int64_t value) {
+  uint64_t mag = value < 0 ? -(uint64_t)value : (uint64_t)value;
+  BigInt *num = bigint_init_size(2);
+  num->digits[0] = (uint32_t)mag;
+  num->digits[1] = (uint32_t)(mag >> 32);
+  num->size = 2;
+  return bigint_signed_result(num, value < 0);
+}
+
+// Changes the sign of a in place (unlike bigint_negate, which takes the
+// two's complement of the magnitude)
+void bigint_neg(BigInt *a) { a->negative = !a->negative && !bigint_is_zero(a); }
+
+int bigint_scmp(const BigInt *a, const BigInt *b) {
+  bool an = a->negative && !bigint_is_zero(a);
+  bool bn = b->negative && !bigint_is_zero(b);
+  if (an != bn) return an ? -1 : 1;
+  int c = bigint_cmp(a, b);
+  return an ? -c : c;
+}
+
+// a + (-1)^b_negative * |b|
+static BigInt *bigint_sadd_sign(const BigInt *a, const BigInt *b,
+                                bool b_negative) {
+  if (a->negative == b_negative)
+    return bigint_signed_result(bigint_add(a, b), a->negative);
+
+  // Opposite signs : difference of the magnitudes, sign of the larger one
+  if (bigint_cmp(a, b) >= 0)
+    return bigint_signed_result(bigint_sub(a, b), a->negative);
+  return bigint_signed_result(bigint_sub(b, a), b_negative);
+}
+
+BigInt *bigint_sadd(const BigInt *a, const BigInt *b) {
+  return bigint_sadd_sign(a, b, b->negative);
+}
+
+BigInt *bigint_ssub(const BigInt *a, const BigInt *b) {
+  return bigint_sadd_sign(a, b, !b->negative);
+}
+
+BigInt *bigint_smul(const BigInt *a, const BigInt *b) {
+  return bigint_signed_result(bigint_mul(a, b), a->negative != b->negative);
+}
+
+// Floor division : q = floor(a / m) and r = a - q * m, r having the sign of
+// m. q or r may be NULL
+void bigint_sdivmod(const BigInt *a, const BigInt *m, BigInt **q, BigInt **r) {
+  BigInt *q0, *r0;
+  bigint_divmod(a, m, &q0, &r0);
+  bool q_negative = a->negative != m->negative;
+
+  // Opposite signs with a remainder : one more step towards -infinity
+  if (q_negative && !bigint_is_zero(r0)) {
+    bigint_add_small(q0, 1);
+    BigInt *tmp = bigint_sub(m, r0);
+    bigint_free(r0);
+    r0 = tmp;
+  }
+
+  if (q)
+    *q = bigint_signed_result(q0, q_negative);
+  else
+    bigint_free(q0);
+  if (r)
+    *r = bigint_signed_result(r0, m->negative);
+  else
+    bigint_free(r0);
+}
+
+// a mod m with the sign of m, in [0, m[ for m > 0
+BigInt *bigint_smod(const BigInt *a, const BigInt *m) {
+  BigInt *r;
+  bigint_sdivmod(a, m, NULL, &r);
+  return r;
+}
+
+// Centered remainder in [|m|/2 - |m|, |m|/2[, as used by DGHV decryption
+BigInt *bigint_smod_centered(const BigInt *a, const BigInt *m) {
+  BigInt *r;
+  bigint_divmod(a, m, NULL, &r);
+  if (a->negative && !bigint_is_zero(r)) {
+    BigInt *tmp = bigint_sub(m, r);
+    bigint_free(r);
+    r = tmp;
+  }
+
+  // r in [0, |m|[ here, shifted down when r >= |m|/2
+  BigInt *half = bigint_div_pow2(m, 1);
+  if (bigint_cmp(r, half) >= 0) {
+    BigInt *tmp = bigint_sub(m, r);
+    bigint_free(r);
+    r = bigint_signed_result(tmp, true);
+  }
+  bigint_free(half);
+  return r;
+}
+
 BigInt *montgomery_reduce(const BigInt *T, const BigInt *m, const BigInt *m_inv, int k_bits) {
   BigInt *m_low = bigint_mul_low(T, m_inv, k_bits);
   BigInt *mn = bigint_mul(m_low, m);
@@ -625,11 +2179,127 @@ BigInt *montgomery_reduce(const BigInt *T, const BigInt *m, const BigInt *m_inv,
   return result;
 }
 
+// Calculates -n^-1 mod 2^32 for odd n (Newton iteration, one word)
+uint32_t montgomery_n0(uint32_t n_low) {
+  assert(n_low & 1);
+  uint32_t x = 1;  // Inverse mod 2, precision doubles at each step
+  for (int i = 0; i < 5; i++) x *= 2 - n_low * x;
+  return -x;
+}
+
+// Calculates -n^-1 mod 2^64 for odd n, for 64-bit word kernels
+uint64_t montgomery_n0_64(uint64_t n_low) {
+  return -bigint_inv_word64(n_low);
+}
+
+// Interleaved loop of the CIOS Montgomery product (Koç et al. 1996)
+// t = (a * b + m * n) / 2^(32s) < 2n, on s + 2 words
+static void montgomery_cios(uint32_t *t, const uint32_t *a, const uint32_t *b,
+                            const uint32_t *n, uint32_t n0, int s) {
+  memset(t, 0, sizeof(uint32_t) * (s + 2));
+
+  for (int i = 0; i < s; i++) {
+    // t += a * b[i]
+    uint64_t carry = 0;
+    for (int j = 0; j < s; j++) {
+      uint64_t sum = (uint64_t)a[j] * b[i] + t[j] + carry;
+      t[j] = (uint32_t)sum;
+      carry = sum >> 32;
+    }
+    uint64_t sum = (uint64_t)t[s] + carry;
+    t[s] = (uint32_t)sum;
+    t[s + 1] = (uint32_t)(sum >> 32);
+
+    // t = (t + m * n) / 2^32
+    uint32_t m = t[0] * n0;
+    carry = ((uint64_t)m * n[0] + t[0]) >> 32;
+    for (int j = 1; j < s; j++) {
+      sum = (uint64_t)m * n[j] + t[j] + carry;
+      t[j - 1] = (uint32_t)sum;
+      carry = sum >> 32;
+    }
+    sum = (uint64_t)t[s] + carry;
+    t[s - 1] = (uint32_t)sum;
+    t[s] = t[s + 1] + (uint32_t)(sum >> 32);
+  }
+}
+
+// res = t - n if t >= n else t, for t < 2n on s + 2 words
+static void montgomery_final_sub(uint32_t *res, const uint32_t *t,
+                                 const uint32_t *n, int s) {
+  int ge = t[s] != 0;
+  if (!ge) {
+    ge = 1;
+    for (int i = s - 1; i >= 0; i--) {
+      if (t[i] != n[i]) {
+        ge = t[i] > n[i];
+        break;
+      }
+    }
+  }
+  if (ge) {
+    bigint_sub_n(res, t, n, s);
+  } else {
+    memcpy(res, t, sizeof(uint32_t) * s);
+  }
+}
+
+// Same as montgomery_final_sub without data-dependent branches : always
+// compute t - n, keep t only if the subtraction underflowed
+static void montgomery_final_sub_ct(uint32_t *res, const uint32_t *t,
+                                    const uint32_t *n, int s) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < s; i++) {
+    uint64_t diff = (uint64_t)t[i] - n[i] - borrow;
+    res[i] = (uint32_t)diff;
+    borrow = (diff >> 32) & 1;
+  }
+  uint32_t mask = -(uint32_t)(borrow & (t[s] ^ 1));
+  for (int i = 0; i < s; i++) res[i] = (t[i] & mask) | (res[i] & ~mask);
+}
+
+// Word-by-word Montgomery multiplication
+// res = a * b * 2^(-32s) mod n, with a, b < n on s words and
+// n0 = -n^-1 mod 2^32. t is a scratch buffer of s + 2 words.
+void montgomery_mul_words(uint32_t *res, const uint32_t *a, const uint32_t *b,
+                          const uint32_t *n, uint32_t n0, int s, uint32_t *t) {
+  montgomery_cios(t, a, b, n, n0, s);
+  montgomery_final_sub(res, t, n, s);
+}
+
+// Same as montgomery_mul_words without data-dependent branches
+void montgomery_mul_words_ct(uint32_t *res, const uint32_t *a,
+                             const uint32_t *b, const uint32_t *n, uint32_t n0,
+                             int s, uint32_t *t) {
+  montgomery_cios(t, a, b, n, n0, s);
+  montgomery_final_sub_ct(res, t, n, s);
+}
+
 // Montgomery multiplication
 BigInt *montgomery_mul(const BigInt *a, const BigInt *b, const BigInt *m, const BigInt *m_inv, int k_bits) {
-  BigInt *T = bigint_mul(a, b);
-  BigInt *res = montgomery_reduce(T, m, m_inv, k_bits);
-  bigint_free(T);
+  int s = m->size;
+  int a_len = a->size, b_len = b->size;
+  while (a_len > 1 && a->digits[a_len - 1] == 0) a_len--;
+  while (b_len > 1 && b->digits[b_len - 1] == 0) b_len--;
+
+  // Generic path when R is not 2^(32s) or an operand is wider than m
+  if (k_bits != 32 * s || a_len > s || b_len > s) {
+    BigInt *T = bigint_mul(a, b);
+    BigInt *res = montgomery_reduce(T, m, m_inv, k_bits);
+    bigint_free(T);
+    return res;
+  }
+
+  uint32_t *buf = calloc(3 * s + 2, sizeof(uint32_t));
+  uint32_t *aw = buf, *bw = buf + s, *t = buf + 2 * s;
+  memcpy(aw, a->digits, sizeof(uint32_t) * a_len);
+  memcpy(bw, b->digits, sizeof(uint32_t) * b_len);
+
+  BigInt *res = bigint_init_size(s);
+  montgomery_mul_words(res->digits, aw, bw, m->digits, m_inv->digits[0], s, t);
+  res->size = s;
+  bigint_trim(res);
+  free(buf);
   return res;
 }
 
@@ -671,656 +2341,655 @@ BigInt *create_R(int k_bits) {
   return R;
 }
 
-BigInt *montgomery_powm(const BigInt *base, const BigInt *exp, const BigInt *modulus) {
-  int k_bits = 32 * (modulus->size);
-  assert(modulus->digits[0] & 1);
+struct bigint_mont_ctx {
+  BigInt *n;
+  int s;              // Number of words of n, R = 2^(32s) with CIOS products
+  uint32_t n0;        // -n^-1 mod 2^32
+  uint32_t *r;        // R mod n
+  uint32_t *r2;       // R^2 mod n
+  uint32_t *work;     // 3s words for operands
+  uint32_t *scratch;  // s + 2 words for the CIOS products
+  int m52;            // Limbs of n in radix 2^52 with IFMA products, else 0.
+                      // R is then 2^(52 * m52)
+  uint64_t n0_52;     // -n^-1 mod 2^52
+  uint64_t *n52;      // n, operands and scratch in radix 2^52
+};
+
+// From this many words of n, Montgomery products use the IFMA kernel
+#define IFMA_MONT_THRESHOLD 8
+
+// Montgomery product with the kernel of the context, res may be a or b.
+// ct selects the final subtraction without data-dependent branches.
+static void bigint_mont_mul_words(uint32_t *res, const uint32_t *a,
+                                  const uint32_t *b, bigint_mont_ctx *ctx,
+                                  bool ct) {
+  const uint32_t *n = ctx->n->digits;
+  int s = ctx->s;
+#ifdef BIGINT_SIMD_X86
+  if (ctx->m52) {
+    int m = ctx->m52;
+    uint64_t *a52 = ctx->n52 + m, *b52 = a52 + m, *d = b52 + m, *x = d + m + 8;
+    uint32_t *t = ctx->scratch;
+    radix52_from_words(a52, m, a, s);
+    if (b != a) radix52_from_words(b52, m, b, s);
+    montgomery_ifma(d, a52, b == a ? a52 : b52, ctx->n52, ctx->n0_52, m, x);
+    radix52_to_words(t, s + 2, d, m + 1);
+    if (ct)
+      montgomery_final_sub_ct(res, t, n, s);
+    else
+      montgomery_final_sub(res, t, n, s);
+    return;
+  }
+#endif
+  if (ct)
+    montgomery_mul_words_ct(res, a, b, n, ctx->n0, s, ctx->scratch);
+  else
+    montgomery_mul_words(res, a, b, n, ctx->n0, s, ctx->scratch);
+}
 
-  BigInt *R = create_R(k_bits);
-  BigInt *R2 = bigint_mul(R, R);
-  BigInt *R2_mod_n = bigint_mod(R2, modulus);
+// Window size for sliding window exponentiation, from the exponent length
+static int montgomery_window_bits(int nbits) {
+  return nbits > 671 ? 6 : nbits > 239 ? 5 : nbits > 79 ? 4 : nbits > 23 ? 3 : 1;
+}
 
-  BigInt *n_prime = bigint_modinv_pow2(modulus, k_bits);
-  BigInt *tmp = bigint_sub(R, n_prime);
-  bigint_free(n_prime);
-  n_prime = tmp;
+// Sliding window exponentiation (HAC, Algorithm 14.85)
+// x = baseM^exp in Montgomery form, x holds R mod n on entry
+static void montgomery_window_sliding(uint32_t *x, const uint32_t *baseM,
+                                      const BigInt *exp,
+                                      bigint_mont_ctx *ctx) {
+  int s = ctx->s;
+  int nbits = bigint_bit_length(exp);
+  int k = montgomery_window_bits(nbits);
+  int count = 1 << (k - 1);
+
+  // Odd powers baseM, baseM^3, ..., baseM^(2^k - 1)
+  uint32_t *table = malloc(sizeof(uint32_t) * s * (count + 1));
+  uint32_t *sq = table + count * s;
+  memcpy(table, baseM, sizeof(uint32_t) * s);
+  if (count > 1) {
+    bigint_mont_mul_words(sq, baseM, baseM, ctx, false);
+    for (int i = 1; i < count; i++)
+      bigint_mont_mul_words(table + i * s, table + (i - 1) * s, sq, ctx, false);
+  }
+
+  bool started = false;
+  int i = nbits - 1;
+  while (i >= 0) {
+    if (!bigint_test_bit(exp, i)) {
+      bigint_mont_mul_words(x, x, x, ctx, false);
+      i--;
+      continue;
+    }
 
-  BigInt *baseM = montgomery_mul(base, R2_mod_n, modulus, n_prime, k_bits);
+    // Longest window of at most k bits ending with a one
+    int j = (i - k + 1 > 0) ? i - k + 1 : 0;
+    while (!bigint_test_bit(exp, j)) j++;
+    uint32_t value = 0;
+    for (int l = i; l >= j; l--) value = (value << 1) | bigint_test_bit(exp, l);
 
-  BigInt *one = bigint_init(1);
-  BigInt *x = montgomery_mul(one, R2_mod_n, modulus, n_prime, k_bits);
+    if (started) {
+      for (int l = i; l >= j; l--) bigint_mont_mul_words(x, x, x, ctx, false);
+      bigint_mont_mul_words(x, x, table + (value >> 1) * s, ctx, false);
+    } else {
+      memcpy(x, table + (value >> 1) * s, sizeof(uint32_t) * s);
+      started = true;
+    }
+    i = j - 1;
+  }
 
-  int nbits = bigint_bit_length(exp);
-  for (int i = nbits - 1; i >= 0; i--) {
-    BigInt *tmp = montgomery_mul(x, x, modulus, n_prime, k_bits);
-    bigint_free(x);
-    x = tmp;
-
-    if (bigint_test_bit(exp, i)) {
-      tmp = montgomery_mul(x, baseM, modulus, n_prime, k_bits);
-      bigint_free(x);
-      x = tmp;
+  free(table);
+}
+
+// Fixed window exponentiation for secret exponents : every window of the
+// bits lowest bits is processed and the table is read in constant time.
+// x = baseM^exp in Montgomery form, x holds R mod n on entry
+static void montgomery_window_fixed(uint32_t *x, const uint32_t *baseM,
+                                    const BigInt *exp, int bits,
+                                    bigint_mont_ctx *ctx) {
+  int s = ctx->s;
+  const int k = 4;
+  const int count = 1 << k;
+
+  // All powers baseM^0, ..., baseM^(2^k - 1)
+  uint32_t *table = malloc(sizeof(uint32_t) * s * (count + 1));
+  uint32_t *sel = table + count * s;
+  memcpy(table, x, sizeof(uint32_t) * s);
+  for (int i = 1; i < count; i++)
+    bigint_mont_mul_words(table + i * s, table + (i - 1) * s, baseM, ctx, true);
+
+  int windows = (bits + k - 1) / k;
+  for (int w = windows - 1; w >= 0; w--) {
+    if (w != windows - 1)
+      for (int l = 0; l < k; l++) bigint_mont_mul_words(x, x, x, ctx, true);
+
+    uint32_t value = 0;
+    for (int l = k - 1; l >= 0; l--)
+      value = (value << 1) | bigint_test_bit(exp, w * k + l);
+
+    // Read every entry, keep the one at index value
+    memset(sel, 0, sizeof(uint32_t) * s);
+    for (int i = 0; i < count; i++) {
+      uint32_t mask = -((((uint32_t)i ^ value) - 1) >> 31);
+      for (int j = 0; j < s; j++) sel[j] |= table[i * s + j] & mask;
     }
+    bigint_mont_mul_words(x, x, sel, ctx, true);
   }
 
-  BigInt *result = montgomery_mul(x, one, modulus, n_prime, k_bits);
+  free(table);
+}
+
+
+bigint_mont_ctx *bigint_mont_init(const BigInt *n) {
+  assert(n->digits[0] & 1);
+  bigint_mont_ctx *ctx = malloc(sizeof(bigint_mont_ctx));
+  ctx->n = bigint_copy(n);
+  bigint_trim(ctx->n);
+  int s = ctx->s = ctx->n->size;
+  ctx->n0 = montgomery_n0(n->digits[0]);
+
+  ctx->r = calloc(2 * s, sizeof(uint32_t));
+  ctx->r2 = ctx->r + s;
+  ctx->work = calloc(4 * s + 2, sizeof(uint32_t));
+  ctx->scratch = ctx->work + 3 * s;
+
+  int r_bits = 32 * s;
+  ctx->m52 = 0;
+  ctx->n52 = NULL;
+#ifdef BIGINT_SIMD_X86
+  if (s >= IFMA_MONT_THRESHOLD && radix52_limbs(s) <= IFMA_MONT_MAX_LIMBS &&
+      bigint_simd_level() >= BIGINT_SIMD_IFMA) {
+    // n, a, b, the result and the columns
+    int m = ctx->m52 = radix52_limbs(s);
+    ctx->n52 = calloc(5 * m + 16, sizeof(uint64_t));
+    radix52_from_words(ctx->n52, m, ctx->n->digits, s);
+    ctx->n0_52 = montgomery_n0_64(ctx->n52[0]) & RADIX52_MASK;
+    r_bits = 52 * m;
+  }
+#endif
+
+  // R mod n and R^2 mod n
+  BigInt *R2 = bigint_init(1);
+  bigint_shift_left_inplace(R2, 2 * r_bits);
+  BigInt *R2_mod_n = bigint_mod(R2, ctx->n);
+  memcpy(ctx->r2, R2_mod_n->digits, sizeof(uint32_t) * R2_mod_n->size);
+  BigInt *R = bigint_div_pow2(R2, r_bits);
+  BigInt *R_mod_n = bigint_mod(R, ctx->n);
+  memcpy(ctx->r, R_mod_n->digits, sizeof(uint32_t) * R_mod_n->size);
 
-  bigint_free(R);
   bigint_free(R2);
   bigint_free(R2_mod_n);
-  bigint_free(n_prime);
-  bigint_free(baseM);
-  bigint_free(x);
-  bigint_free(one);
-  bigint_trim(result);
-  return result;
+  bigint_free(R);
+  bigint_free(R_mod_n);
+  return ctx;
 }
 
-// Montgomery powm with precomputed R, R2_mod_n, and n_prime
-BigInt *montgomery_powm_precalc(const BigInt *base, const BigInt *exp,
-                                const BigInt *modulus, BigInt *R,
-                                BigInt *R2_mod_n, BigInt *n_prime) {
-  int k_bits = 32 * (modulus->size);
-  assert(modulus->digits[0] & 1);
-
-  BigInt *R_mod_n = bigint_mod(R, modulus);
-  BigInt *baseM = montgomery_mul(base, R2_mod_n, modulus, n_prime, k_bits);
-
-  BigInt *one = bigint_init(1);
-  BigInt *x = montgomery_mul(one, R2_mod_n, modulus, n_prime, k_bits);
+void bigint_mont_free(bigint_mont_ctx *ctx) {
+  bigint_free(ctx->n);
+  free(ctx->n52);
+  free(ctx->r);
+  free(ctx->work);
+  free(ctx);
+}
 
-  int nbits = bigint_bit_length(exp);
-  for (int i = nbits - 1; i >= 0; i--) {
-    BigInt *tmp = montgomery_mul(x, x, modulus, n_prime, k_bits);
-    bigint_free(x);
-    x = tmp;
-
-    if (bigint_test_bit(exp, i)) {
-      tmp = montgomery_mul(x, baseM, modulus, n_prime, k_bits);
-      bigint_free(x);
-      x = tmp;
-    }
+// Copies a mod n to an s-word buffer. Words above s are zero (a < n), even
+// when a is not trimmed.
+static void bigint_mont_load(uint32_t *dst, const BigInt *a,
+                             const bigint_mont_ctx *ctx) {
+  int s = ctx->s;
+  memset(dst, 0, sizeof(uint32_t) * s);
+  if (bigint_cmp(a, ctx->n) >= 0) {
+    BigInt *reduced = bigint_mod(a, ctx->n);
+    memcpy(dst, reduced->digits,
+           sizeof(uint32_t) * (reduced->size < s ? reduced->size : s));
+    bigint_free(reduced);
+  } else {
+    memcpy(dst, a->digits, sizeof(uint32_t) * (a->size < s ? a->size : s));
   }
+}
 
-  BigInt *result = montgomery_mul(x, one, modulus, n_prime, k_bits);
-
-  bigint_free(R_mod_n);
-  bigint_free(baseM);
-  bigint_free(x);
-  bigint_free(one);
+static BigInt *bigint_mont_store(const uint32_t *src,
+                                 const bigint_mont_ctx *ctx) {
+  BigInt *result = bigint_init_size(ctx->s);
+  memcpy(result->digits, src, sizeof(uint32_t) * ctx->s);
+  result->size = ctx->s;
   bigint_trim(result);
   return result;
 }
 
-// Right shift (division par 2)
-void bigint_shift_right_inplace(BigInt *n) {
-  uint32_t carry = 0;
-  for (int i = n->size - 1; i >= 0; i--) {
-    uint32_t new_carry = n->digits[i] & 1;
-    n->digits[i] = (n->digits[i] >> 1) | (carry << 31);
-    carry = new_carry;
-  }
-  bigint_trim(n);
+// Montgomery product a * b * R^-1 mod n
+BigInt *bigint_mont_mul(const BigInt *a, const BigInt *b,
+                        bigint_mont_ctx *ctx) {
+  int s = ctx->s;
+  uint32_t *aw = ctx->work, *bw = ctx->work + s;
+  bigint_mont_load(aw, a, ctx);
+  bigint_mont_load(bw, b, ctx);
+  bigint_mont_mul_words(aw, aw, bw, ctx, false);
+  return bigint_mont_store(aw, ctx);
 }
 
-// Miller-Rabin primality test
-bool is_probable_prime(BigInt *n, int iterations) {
-  int k_bits = 32 * (n->size);
-  assert(n->digits[0] & 1);
-
-  BigInt *R = create_R(k_bits);
-  BigInt *R2 = bigint_mul(R, R);
-  BigInt *R2_mod_n = bigint_mod(R2, n);
-
-  BigInt *n_prime = bigint_modinv_pow2(n, k_bits);
-  BigInt *tmp = bigint_sub(R, n_prime);
-  bigint_free(n_prime);
-  n_prime = tmp;
+// a * R mod n
+BigInt *bigint_mont_to(const BigInt *a, bigint_mont_ctx *ctx) {
+  uint32_t *aw = ctx->work;
+  bigint_mont_load(aw, a, ctx);
+  bigint_mont_mul_words(aw, aw, ctx->r2, ctx, false);
+  return bigint_mont_store(aw, ctx);
+}
 
-  BigInt *one = bigint_init(1);
+// a * R^-1 mod n
+BigInt *bigint_mont_from(const BigInt *a, bigint_mont_ctx *ctx) {
+  int s = ctx->s;
+  uint32_t *aw = ctx->work, *one = ctx->work + s;
+  bigint_mont_load(aw, a, ctx);
+  memset(one, 0, sizeof(uint32_t) * s);
+  one[0] = 1;
+  bigint_mont_mul_words(aw, aw, one, ctx, false);
+  return bigint_mont_store(aw, ctx);
+}
 
-  BigInt *n_minus_1 = bigint_sub(n, one);
-  BigInt *d = bigint_copy(n_minus_1);
-  int s = 0;
-  while ((d->digits[0] & 1) == 0) {
-    bigint_shift_right_inplace(d);
-    s++;
+// Exponentiation on word buffers with CIOS products, the result x is left
+// in Montgomery form. ct selects the constant-time fixed window variant
+static void bigint_mont_powm_raw(uint32_t *x, const BigInt *base,
+                                 const BigInt *exp, bigint_mont_ctx *ctx,
+                                 bool ct) {
+  int s = ctx->s;
+  uint32_t *baseM = ctx->work + s, *tmp = ctx->work + 2 * s;
+
+  // baseM = base * R mod n, x = R mod n
+  bigint_mont_load(tmp, base, ctx);
+  bigint_mont_mul_words(baseM, tmp, ctx->r2, ctx, ct);
+  memcpy(x, ctx->r, sizeof(uint32_t) * s);
+
+  if (ct) {
+    int bits = 32 * (exp->size > s ? exp->size : s);
+    montgomery_window_fixed(x, baseM, exp, bits, ctx);
+  } else {
+    montgomery_window_sliding(x, baseM, exp, ctx);
   }
+}
 
-  for (int i = 0; i < iterations; i++) {
-    BigInt *a = bigint_random_range(one, n_minus_1);
-
-    BigInt *x = montgomery_powm_precalc(a, d, n, R, R2_mod_n, n_prime);
+static BigInt *bigint_mont_powm_words(const BigInt *base, const BigInt *exp,
+                                      bigint_mont_ctx *ctx, bool ct) {
+  int s = ctx->s;
+  uint32_t *x = ctx->work, *tmp = ctx->work + 2 * s;
+  bigint_mont_powm_raw(x, base, exp, ctx, ct);
+
+  // Back from Montgomery form
+  memset(tmp, 0, sizeof(uint32_t) * s);
+  tmp[0] = 1;
+  bigint_mont_mul_words(x, x, tmp, ctx, ct);
+  return bigint_mont_store(x, ctx);
+}
 
-    if (bigint_cmp(x, one) == 0 || bigint_cmp(x, n_minus_1) == 0) {
-      bigint_free(x);
-      continue;
-    }
+BigInt *bigint_mont_powm(const BigInt *base, const BigInt *exp,
+                         bigint_mont_ctx *ctx) {
+#ifdef BIGINT_GMP
+  return bigint_gmp_powm(base, exp, ctx->n, false);
+#endif
+  return bigint_mont_powm_words(base, exp, ctx, false);
+}
 
-    bool witness = true;
-    for (int r = 1; r < s; r++) {
-      BigInt *x_squared = bigint_mul(x, x);
-      bigint_free(x);
-      x = bigint_mod(x_squared, n);
-      bigint_free(x_squared);
+// Constant-time exponentiation for secret exponents
+// Only the word lengths of exp and n are leaked
+BigInt *bigint_mont_powm_ct(const BigInt *base, const BigInt *exp,
+                            bigint_mont_ctx *ctx) {
+#ifdef BIGINT_GMP
+  return bigint_gmp_powm(base, exp, ctx->n, true);
+#endif
+  return bigint_mont_powm_words(base, exp, ctx, true);
+}
 
-      if (bigint_cmp(x, n_minus_1) == 0) {
-        witness = false;
-        break;
+// Batched exponentiation : MONT_BATCH_LANES bases run the same window
+// schedule and their Montgomery products are computed together, so that
+// the independent carry chains overlap in the pipeline
+#define MONT_BATCH_LANES 4
+
+// CIOS products of the lanes in the same loops, t holds s + 2 words per lane
+static void montgomery_cios_lanes(uint32_t *t, uint32_t *const *a,
+                                  uint32_t *const *b, const uint32_t *n,
+                                  uint32_t n0, int s) {
+  enum { L = MONT_BATCH_LANES };
+  int ts = s + 2;
+  memset(t, 0, sizeof(uint32_t) * ts * L);
+
+  for (int i = 0; i < s; i++) {
+    // t += a * b[i]
+    uint64_t carry[L] = {0};
+    uint32_t bi[L];
+    for (int l = 0; l < L; l++) bi[l] = b[l][i];
+    for (int j = 0; j < s; j++) {
+      for (int l = 0; l < L; l++) {
+        uint64_t sum = (uint64_t)a[l][j] * bi[l] + t[l * ts + j] + carry[l];
+        t[l * ts + j] = (uint32_t)sum;
+        carry[l] = sum >> 32;
       }
     }
-
-    if (witness) {
-      // Not prime
-      bigint_free(n_minus_1);
-      bigint_free(x);
-      bigint_free(R);
-      bigint_free(R2_mod_n);
-      bigint_free(n_prime);
-      bigint_free(one);
-      bigint_free(d);
-      return false;
+    uint32_t m[L];
+    for (int l = 0; l < L; l++) {
+      uint32_t *tl = t + l * ts;
+      uint64_t sum = (uint64_t)tl[s] + carry[l];
+      tl[s] = (uint32_t)sum;
+      tl[s + 1] = (uint32_t)(sum >> 32);
+      m[l] = tl[0] * n0;
+      carry[l] = ((uint64_t)m[l] * n[0] + tl[0]) >> 32;
     }
-  }
 
-  // Probably prime
-  bigint_free(n_minus_1);
-  bigint_free(R);
-  bigint_free(R2_mod_n);
-  bigint_free(n_prime);
-  bigint_free(one);
-  bigint_free(d);
-  return true;
-}
-
-bool is_trivial_composite(BigInt *n) {
-  int size = 5;
-  char **hexes = malloc(size * sizeof(char *));
-  hexes[0] = "0x3";  // 3
-  hexes[1] = "0x5";  // 5
-  hexes[2] = "0x7";  // 7
-  hexes[3] = "0xB";  // 11
-  hexes[4] = "0xD";  // 13
-
-  for (int i = 0; i < size; i++) {
-    BigInt *prime = bigint_from_hex(hexes[i]);
-    if (bigint_mod(n, prime) == 0) {
-      bigint_free(prime);
-      free(hexes);
-      return true;
+    // t = (t + m * n) / 2^32
+    for (int j = 1; j < s; j++) {
+      for (int l = 0; l < L; l++) {
+        uint64_t sum = (uint64_t)m[l] * n[j] + t[l * ts + j] + carry[l];
+        t[l * ts + j - 1] = (uint32_t)sum;
+        carry[l] = sum >> 32;
+      }
     }
-    bigint_free(prime);
-  }
-  free(hexes);
-  return false;
-}
-
-// Generate a prime
-BigInt *bigint_generate_prime(int bits, int iterations) {
-  while (true) {
-    BigInt *num = bigint_random(bits / 32 + 1);
-    // Ensure it's odd
-    num->digits[0] |= 1;
-    // Ensure it's bits bits long
-    num->digits[bits / 32] |= 1 << (bits % 32);
-
-    // printf("Testing primality of: ");
-    // bigint_print(num);
-    if (!is_trivial_composite(num)) {
-      if (is_probable_prime(num, iterations)) return num;
+    for (int l = 0; l < L; l++) {
+      uint32_t *tl = t + l * ts;
+      uint64_t sum = (uint64_t)tl[s] + carry[l];
+      tl[s - 1] = (uint32_t)sum;
+      tl[s] = tl[s + 1] + (uint32_t)(sum >> 32);
     }
-    bigint_free(num);
   }
 }
 
-void test_modinv_with_gmp(const char *m_hex, int k) {
-  mpz_t gmp_m, gmp_result;
-  mpz_init(gmp_m);
-  mpz_init(gmp_result);
-
-  BigInt *m = bigint_from_hex(m_hex);
-  mpz_set_str(gmp_m, m_hex, 16);
-
-  mpz_t gmp_mod;
-  mpz_init(gmp_mod);
-  mpz_ui_pow_ui(gmp_mod, 2, k);  // 2^k
-
-  if (mpz_invert(gmp_result, gmp_m, gmp_mod) == 0) {
-    printf("Aucun inverse modulaire n'existe.\n");
+// res[l] = a[l] * b[l] * R^-1 mod n for every lane, res[l] may be a[l] or
+// b[l]. The IFMA kernel is already vectorised, its products run in turn.
+static void bigint_mont_mul_lanes(uint32_t *const *res, uint32_t *const *a,
+                                  uint32_t *const *b, bigint_mont_ctx *ctx,
+                                  bool ct, uint32_t *t) {
+  int s = ctx->s;
+  if (ctx->m52) {
+    for (int l = 0; l < MONT_BATCH_LANES; l++)
+      bigint_mont_mul_words(res[l], a[l], b[l], ctx, ct);
     return;
   }
-
-  BigInt *result = bigint_modinv_pow2(m, k);
-
-  printf("Résultat GMP     : 0x");
-  gmp_printf("%Zx\n", gmp_result);
-
-  printf("Résultat BigInt  : 0x");
-  for (int i = result->size - 1; i >= 0; i--) {
-    printf("%08X", result->digits[i]);
+  montgomery_cios_lanes(t, a, b, ctx->n->digits, ctx->n0, s);
+  for (int l = 0; l < MONT_BATCH_LANES; l++) {
+    if (ct)
+      montgomery_final_sub_ct(res[l], t + l * (s + 2), ctx->n->digits, s);
+    else
+      montgomery_final_sub(res[l], t + l * (s + 2), ctx->n->digits, s);
   }
-  printf("\n");
-
-  bigint_free(m);
-  bigint_free(result);
-  mpz_clear(gmp_mod);
-  mpz_clear(gmp_m);
-  mpz_clear(gmp_result);
 }
 
-void test_montgomery_reduce_once(const char *hex_T, const char *hex_m,
-                                 const char *hex_m_inv, int k_bits) {
-  BigInt *T = bigint_from_hex(hex_T);
-  BigInt *m = bigint_from_hex(hex_m);
-  BigInt *m_inv = bigint_from_hex(hex_m_inv);
-
-  BigInt *res_my = montgomery_reduce(T, m, m_inv, k_bits);
-
-  mpz_t G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t;
-  mpz_inits(G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t, NULL);
-
-  mpz_set_str(G_T, hex_T, 16);
-  mpz_set_str(G_m, hex_m, 16);
-  mpz_set_str(G_m_inv, hex_m_inv, 16);
-
-  mpz_ui_pow_ui(G_R, 2, k_bits);
-
-  mpz_mul(G_u, G_T, G_m_inv);
-  mpz_mod(G_u, G_u, G_R);
-
-  mpz_mul(G_sum, G_u, G_m);
-  mpz_add(G_sum, G_sum, G_T);
-
-  mpz_tdiv_q_2exp(G_t, G_sum, k_bits);
-
-  mpz_mod(G_t, G_t, G_m);
-  char *str_gmp = mpz_get_str(NULL, 16, G_t);
-
-  printf("T       = 0x%s\n", hex_T);
-  printf("m       = 0x%s\n", hex_m);
-  printf("m_inv   = 0x%s\n", hex_m_inv);
-  printf("k_bits  = %d\n", k_bits);
-  printf("résultat attendu GMP = 0x%s\n", str_gmp);
-  printf("résultat BigInt      = ");
-  bigint_print(res_my);
+// Fixed window exponentiation of MONT_BATCH_LANES bases at once over the
+// bits lowest bits of the exponents. Only the first lanes lanes are used,
+// the others compute 0^0. ct reads the tables in constant time.
+static void bigint_mont_powm_lanes(BigInt **res, const BigInt *const *bases,
+                                   const BigInt *const *exps, int lanes,
+                                   int bits, bigint_mont_ctx *ctx, bool ct) {
+  enum { L = MONT_BATCH_LANES };
+  int s = ctx->s;
+  int k = ct ? 4 : montgomery_window_bits(bits);
+  int count = 1 << k;
+
+  uint32_t *buf = calloc((size_t)s * L * (count + 4) + (s + 2) * L,
+                         sizeof(uint32_t));
+  uint32_t *table = buf;  // count powers per lane
+  uint32_t *x = table + (size_t)s * L * count, *baseM = x + s * L;
+  uint32_t *sel = baseM + s * L, *one = sel + s * L, *t = one + s * L;
+  uint32_t *xs[L], *bs[L], *ss[L], *ones[L], *r2s[L], *prev[L], *cur[L];
+  for (int l = 0; l < L; l++) {
+    xs[l] = x + l * s;
+    bs[l] = baseM + l * s;
+    ss[l] = sel + l * s;
+    ones[l] = one + l * s;
+    r2s[l] = ctx->r2;
+    ones[l][0] = 1;
+    if (l < lanes) bigint_mont_load(xs[l], bases[l], ctx);
+  }
+
+  // baseM = base * R mod n, table[i] = baseM^i
+  bigint_mont_mul_lanes(bs, xs, r2s, ctx, ct, t);
+  for (int l = 0; l < L; l++) {
+    memcpy(table + (size_t)l * count * s, ctx->r, sizeof(uint32_t) * s);
+    memcpy(xs[l], ctx->r, sizeof(uint32_t) * s);
+  }
+  for (int i = 1; i < count; i++) {
+    for (int l = 0; l < L; l++) {
+      prev[l] = table + ((size_t)l * count + i - 1) * s;
+      cur[l] = prev[l] + s;
+    }
+    bigint_mont_mul_lanes(cur, prev, bs, ctx, ct, t);
+  }
+
+  int windows = (bits + k - 1) / k;
+  for (int w = windows - 1; w >= 0; w--) {
+    if (w != windows - 1)
+      for (int i = 0; i < k; i++) bigint_mont_mul_lanes(xs, xs, xs, ctx, ct, t);
+
+    for (int l = 0; l < L; l++) {
+      uint32_t value = 0;
+      for (int i = k - 1; i >= 0; i--)
+        value = (value << 1) |
+                (l < lanes ? bigint_test_bit(exps[l], w * k + i) : 0);
+      const uint32_t *lane = table + (size_t)l * count * s;
+      if (!ct) {
+        memcpy(ss[l], lane + value * s, sizeof(uint32_t) * s);
+        continue;
+      }
+      // Read every entry, keep the one at index value
+      memset(ss[l], 0, sizeof(uint32_t) * s);
+      for (int i = 0; i < count; i++) {
+        uint32_t mask = -((((uint32_t)i ^ value) - 1) >> 31);
+        for (int j = 0; j < s; j++) ss[l][j] |= lane[i * s + j] & mask;
+      }
+    }
+    bigint_mont_mul_lanes(xs, xs, ss, ctx, ct, t);
+  }
 
-  free(str_gmp);
-  bigint_free(T);
-  bigint_free(m);
-  bigint_free(m_inv);
-  bigint_free(res_my);
-  mpz_clears(G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t, NULL);
+  // Back from Montgomery form
+  bigint_mont_mul_lanes(xs, xs, ones, ctx, ct, t);
+  for (int l = 0; l < lanes; l++) res[l] = bigint_mont_store(xs[l], ctx);
+  free(buf);
 }
 
-void test_montgomery_mul_once(const char *hex_a, const char *hex_b,
-                              const char *hex_m, int k_bits) {
-  BigInt *a = bigint_from_hex(hex_a);
-  BigInt *b = bigint_from_hex(hex_b);
-  BigInt *m = bigint_from_hex(hex_m);
-
-  BigInt *minv = bigint_modinv_pow2(m, k_bits);
-  bigint_negate(minv);
-
-  BigInt *res_my = montgomery_mul(a, b, m, minv, k_bits);
-
-  mpz_t G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res;
-  mpz_inits(G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res, NULL);
-
-  mpz_set_str(G_a, hex_a, 16);
-  mpz_set_str(G_b, hex_b, 16);
-  mpz_set_str(G_m, hex_m, 16);
-
-  mpz_ui_pow_ui(G_R, 2, k_bits);
-
-  if (mpz_invert(G_minv, G_m, G_R) == 0) {
-    fprintf(stderr, "mpz_invert failed\n");
-    exit(1);
+static void bigint_mont_powm_batch_run(BigInt **res, BigInt *const *bases,
+                                       BigInt *const *exps, int count,
+                                       bigint_mont_ctx *ctx, bool ct) {
+#ifdef BIGINT_GMP
+  for (int i = 0; i < count; i++)
+    res[i] = bigint_gmp_powm(bases[i], exps[i], ctx->n, ct);
+  return;
+#endif
+  // Shared schedule : the longest exponent, and at least n for ct
+  int bits = 1;
+  for (int i = 0; i < count; i++) {
+    int b = ct ? 32 * exps[i]->size : bigint_bit_length(exps[i]);
+    if (b > bits) bits = b;
+  }
+  if (ct && bits < 32 * ctx->s) bits = 32 * ctx->s;
+
+  for (int i = 0; i < count; i += MONT_BATCH_LANES) {
+    // The last group may leave lanes unused
+    int lanes = count - i < MONT_BATCH_LANES ? count - i : MONT_BATCH_LANES;
+    bigint_mont_powm_lanes(res + i, (const BigInt *const *)bases + i,
+                           (const BigInt *const *)exps + i, lanes, bits, ctx,
+                           ct);
   }
-  mpz_neg(G_minv, G_minv);
-  mpz_mod(G_minv, G_minv, G_R);
-
-  mpz_mul(G_T, G_a, G_b);
-
-  mpz_mul(G_u, G_T, G_minv);
-  mpz_mod(G_u, G_u, G_R);
-
-  mpz_mul(G_sum, G_u, G_m);
-  mpz_add(G_sum, G_sum, G_T);
-
-  mpz_tdiv_q_2exp(G_t, G_sum, k_bits);
-  mpz_mod(G_res, G_t, G_m);
-
-  char *str_gmp = mpz_get_str(NULL, 16, G_res);
-
-  printf("a       = 0x%s\n", hex_a);
-  printf("b       = 0x%s\n", hex_b);
-  printf("m       = 0x%s\n", hex_m);
-  printf("k_bits  = %d\n", k_bits);
-  printf("Résultat GMP    = 0x%s\n", str_gmp);
-  printf("Résultat BigInt = ");
-  bigint_print(res_my);
-
-  free(str_gmp);
-  bigint_free(a);
-  bigint_free(b);
-  bigint_free(m);
-  bigint_free(minv);
-  bigint_free(res_my);
-  mpz_clears(G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res, NULL);
 }
 
-void test_montgomery_powm(const char *hex_base, const char *hex_exp,
-                          const char *hex_mod, int k_bits) {
-  BigInt *B = bigint_from_hex(hex_base);
-  BigInt *E = bigint_from_hex(hex_exp);
-  BigInt *M = bigint_from_hex(hex_mod);
-
-  BigInt *R_my = montgomery_powm(B, E, M);
-
-  mpz_t gB, gE, gM, gR;
-  mpz_inits(gB, gE, gM, gR, NULL);
-  mpz_set_str(gB, hex_base, 16);
-  mpz_set_str(gE, hex_exp, 16);
-  mpz_set_str(gM, hex_mod, 16);
-  mpz_powm(gR, gB, gE, gM);
-
-  char *s_gmp = mpz_get_str(NULL, 16, gR);
-
-  printf("base       = 0x%s\n", hex_base);
-  printf("exp        = 0x%s\n", hex_exp);
-  printf("mod        = 0x%s\n", hex_mod);
-  printf("k_bits     = %d\n", k_bits);
-  printf("résultat GMP    = 0x%s\n", s_gmp);
-  printf("résultat BigInt = ");
-  bigint_print(R_my);
-
-  free(s_gmp);
-  bigint_free(B);
-  bigint_free(E);
-  bigint_free(M);
-  bigint_free(R_my);
-  mpz_clears(gB, gE, gM, gR, NULL);
+// res[i] = bases[i]^exps[i] mod n for count pairs under the modulus of ctx
+void bigint_mont_powm_batch(BigInt **res, BigInt *const *bases,
+                            BigInt *const *exps, int count,
+                            bigint_mont_ctx *ctx) {
+  bigint_mont_powm_batch_run(res, bases, exps, count, ctx, false);
 }
 
-void test_primality_with_gmp(const char *hex_n, int iterations) {
-  mpz_t gmp_n;
-  mpz_init(gmp_n);
-  mpz_set_str(gmp_n, hex_n, 16);
-  BigInt *n = bigint_from_hex(hex_n);
-
-  int is_prime = mpz_probab_prime_p(gmp_n, iterations);
-  int is_prime_bigint = is_probable_prime(n, iterations);
-
-  printf("Résultat GMP : %s\n", is_prime ? "Premier" : "Non premier");
-  printf("Résultat BigInt : %s\n", is_prime_bigint ? "Premier" : "Non premier");
-
-  mpz_clear(gmp_n);
+// Constant-time batch : every lane runs the same schedule, only the word
+// lengths of the longest exponent and of n are leaked
+void bigint_mont_powm_batch_ct(BigInt **res, BigInt *const *bases,
+                               BigInt *const *exps, int count,
+                               bigint_mont_ctx *ctx) {
+  bigint_mont_powm_batch_run(res, bases, exps, count, ctx, true);
 }
 
-int main() {
-  char *sep = "----------------------------------------\n";
-  if (true) {
-    printf("%s", sep);
-    printf("Addition\n");
+BigInt *montgomery_powm(const BigInt *base, const BigInt *exp, const BigInt *modulus) {
+  bigint_mont_ctx *ctx = bigint_mont_init(modulus);
+  BigInt *result = bigint_mont_powm(base, exp, ctx);
+  bigint_mont_free(ctx);
+  return result;
+}
 
-    mpz_t gmp_a, gmp_b, gmp_result;
-    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
-    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
-    mpz_init(gmp_result);
-    mpz_add(gmp_result, gmp_a, gmp_b);
-    BigInt *a = bigint_from_hex("123456789012345678901234567890");
-    BigInt *b = bigint_from_hex("987654321098765432109876543210");
-    BigInt *result = bigint_add(a, b);
-
-    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
-    printf("Résultat BigInt  : ");
-    bigint_print(result);
-    bigint_free(a);
-    bigint_free(b);
-    bigint_free(result);
-    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
-  }
+BigInt *montgomery_powm_ct(const BigInt *base, const BigInt *exp,
+                           const BigInt *modulus) {
+  bigint_mont_ctx *ctx = bigint_mont_init(modulus);
+  BigInt *result = bigint_mont_powm_ct(base, exp, ctx);
+  bigint_mont_free(ctx);
+  return result;
+}
 
-  if (true) {
-    printf("%s", sep);
-    printf("Soustraction\n");
+// Right shift (division par 2)
+void bigint_shift_right_inplace(BigInt *n) {
+  bigint_rshift(n->digits, n->digits, n->size, 1, 0);
+  bigint_trim(n);
+}
 
-    const char *hex_a = "0000000100000000000000000000000000000000";
-    const char *hex_b = "0004FFFFFFFFFFFFFFFFFFFFFFFFFFFF";
+// Miller-Rabin primality test
+bool is_probable_prime(BigInt *n, int iterations) {
+  assert(n->digits[0] & 1);
+#ifdef BIGINT_GMP
+  return bigint_gmp_is_probable_prime(n, iterations);
+#endif
 
-    mpz_t gmp_a, gmp_b, gmp_result;
-    mpz_init_set_str(gmp_a, hex_a, 16);
-    mpz_init_set_str(gmp_b, hex_b, 16);
-    mpz_init(gmp_result);
-    mpz_sub(gmp_result, gmp_a, gmp_b);
-    BigInt *a = bigint_from_hex(hex_a);
-    BigInt *b = bigint_from_hex(hex_b);
-    BigInt *result = bigint_sub(a, b);
+  bigint_mont_ctx *mont = bigint_mont_init(n);
+  int sw = mont->s;
+  const uint32_t *nw = mont->n->digits;
+  BigInt *one = bigint_init(1);
 
-    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
-    printf("Résultat BigInt  : ");
-    bigint_print(result);
-    bigint_free(a);
-    bigint_free(b);
-    bigint_free(result);
-    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  BigInt *n_minus_1 = bigint_sub(n, one);
+  BigInt *d = bigint_copy(n_minus_1);
+  int s = 0;
+  while ((d->digits[0] & 1) == 0) {
+    bigint_shift_right_inplace(d);
+    s++;
   }
 
-  if (true) {
-    printf("%s", sep);
-    printf("Multiplication\n");
-
-    mpz_t gmp_a, gmp_b, gmp_result;
-    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
-    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
-    mpz_init(gmp_result);
-    mpz_mul(gmp_result, gmp_a, gmp_b);
-    BigInt *a = bigint_from_hex("123456789012345678901234567890");
-    BigInt *b = bigint_from_hex("987654321098765432109876543210");
-    BigInt *result = bigint_mul(a, b);
-
-    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
-    printf("Résultat BigInt  : ");
-    bigint_print(result);
-    bigint_free(a);
-    bigint_free(b);
-    bigint_free(result);
-    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  // 1 and -1 in Montgomery form : R mod n and n - (R mod n)
+  uint32_t *x = malloc(sizeof(uint32_t) * 2 * sw);
+  uint32_t *minus_one = x + sw;
+  uint64_t borrow = 0;
+  for (int i = 0; i < sw; i++) {
+    uint64_t diff = (uint64_t)nw[i] - mont->r[i] - borrow;
+    minus_one[i] = (uint32_t)diff;
+    borrow = (diff >> 32) ? 1 : 0;
   }
+  size_t bytes = sizeof(uint32_t) * sw;
 
-  if (true) {
-    printf("%s", sep);
-    printf("Modulo\n");
-
-    mpz_t gmp_a, gmp_b, gmp_result;
-    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
-    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
-    mpz_init(gmp_result);
-    mpz_mod(gmp_result, gmp_b, gmp_a);
-    BigInt *a = bigint_from_hex("123456789012345678901234567890");
-    BigInt *b = bigint_from_hex("987654321098765432109876543210");
-    BigInt *result = bigint_mod(b, a);
-
-    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
-    printf("Résultat BigInt  : ");
-    bigint_print(result);
+  bool prime = true;
+  for (int i = 0; i < iterations && prime; i++) {
+    BigInt *a = bigint_random_range(one, n_minus_1);
+    bigint_mont_powm_raw(x, a, d, mont, false);
     bigint_free(a);
-    bigint_free(b);
-    bigint_free(result);
-    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
-  }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Multiplication basse\n");
-
-    mpz_t gmp_a, gmp_b, gmp_res, gmp_mask;
-    mpz_inits(gmp_a, gmp_b, gmp_res, gmp_mask, NULL);
-
-    mpz_set_str(gmp_a, "FFFFFFFFFFFFFFFFFFFFFFFF", 16);
-    mpz_set_str(gmp_b, "12345678", 16);
 
-    mpz_mul(gmp_res, gmp_a, gmp_b);
+    if (memcmp(x, mont->r, bytes) == 0 || memcmp(x, minus_one, bytes) == 0)
+      continue;
 
-    // Mask on k_bits (simuling bigint_mul_low)
-    mpz_setbit(gmp_mask, 96);
-    mpz_sub_ui(gmp_mask, gmp_mask, 1);
-    mpz_and(gmp_res, gmp_res, gmp_mask);
+    // Witness unless a square reaches -1
+    prime = false;
+    for (int r = 1; r < s; r++) {
+      bigint_mont_mul_words(x, x, x, mont, false);
+      if (memcmp(x, minus_one, bytes) == 0) {
+        prime = true;
+        break;
+      }
+    }
+  }
 
-    char *gmp_str = mpz_get_str(NULL, 16, gmp_res);
+  free(x);
+  bigint_free(n_minus_1);
+  bigint_free(one);
+  bigint_free(d);
+  bigint_mont_free(mont);
+  return prime;
+}
 
-    BigInt *a = bigint_from_hex("FFFFFFFFFFFFFFFFFFFFFFFF");
-    BigInt *b = bigint_from_hex("12345678");
-    BigInt *my_res = bigint_mul_low(a, b, 96);
+// Odd primes below SMALL_PRIMES_BOUND, sieved on first use
+#define SMALL_PRIMES_BOUND 65536
+// Number of consecutive odd candidates tried from one random draw
+#define PRIME_SIEVE_SPAN 65536
+
+static uint32_t *small_primes = NULL;
+static int small_primes_count = 0;
+static pthread_once_t small_primes_once = PTHREAD_ONCE_INIT;
+
+static void small_primes_sieve(void) {
+  char *composite = calloc(SMALL_PRIMES_BOUND, sizeof(char));
+  small_primes = malloc(sizeof(uint32_t) * SMALL_PRIMES_BOUND / 2);
+  for (uint32_t i = 3; i < SMALL_PRIMES_BOUND; i += 2) {
+    if (composite[i]) continue;
+    small_primes[small_primes_count++] = i;
+    for (uint32_t j = i * i; j < SMALL_PRIMES_BOUND; j += 2 * i)
+      composite[j] = 1;
+  }
+  small_primes =
+      realloc(small_primes, sizeof(uint32_t) * small_primes_count);
+  free(composite);
+}
 
-    bigint_print(a);
-    bigint_print(b);
-    printf("Résultat GMP      : 0x%s\n", gmp_str);
-    printf("Résultat BigInt   : ");
-    bigint_print(my_res);
+static void small_primes_init(void) {
+  pthread_once(&small_primes_once, small_primes_sieve);
+}
 
-    free(gmp_str);
-    bigint_free(a);
-    bigint_free(b);
-    bigint_free(my_res);
-    mpz_clears(gmp_a, gmp_b, gmp_res, gmp_mask, NULL);
+// Trial division by the small primes table
+bool is_trivial_composite(BigInt *n) {
+  small_primes_init();
+  if ((n->digits[0] & 1) == 0) return bigint_cmp_small(n, 2) != 0;
+  for (int i = 0; i < small_primes_count; i++) {
+    if (bigint_mod_small(n, small_primes[i]) == 0)
+      return bigint_cmp_small(n, small_primes[i]) != 0;
   }
+  return false;
+}
 
-  if (true) {
-    printf("%s", sep);
-    printf("Inverse modulaire\n");
-
-    const char *m = "FFFAFFFFFFFFFFFFFFFFFFFFFFFFFFFF";
-    const char *m_inv = "4ffffffffffffffffffffffffffff";
-    int k = 128;
+// Generate a prime of exactly bits bits
+// Consecutive odd candidates from one random draw are sieved with the
+// residues modulo the small primes, updated as the candidate is stepped by 2
+BigInt *bigint_generate_prime(int bits, int iterations) {
+  assert(bits >= 3);
+  small_primes_init();
+  int words = (bits + 31) / 32;
+  int top = (bits - 1) % 32;
 
-    test_modinv_with_gmp(m, k);
-    test_modinv_with_gmp(m_inv, k);
+  // Only primes below the candidates can be used to sieve them
+  int count = small_primes_count;
+  if (bits <= 32) {
+    count = 0;
+    while (count < small_primes_count &&
+           small_primes[count] < (1u << (bits - 1)))
+      count++;
   }
+  uint32_t *residues = malloc(sizeof(uint32_t) * (count ? count : 1));
 
-  if (true) {
-    printf("%s", sep);
-    printf("Shift à droite (division par 2)\n");
-
-    int s = 24;
-    BigInt *a = bigint_from_hex("123456789012345678901234567890");
-    BigInt *result = bigint_div_pow2(a, s);
-    bigint_print(a);
-    printf(">> %i  : \n", s);
-    bigint_print(result);
-    bigint_free(a);
-    bigint_free(result);
-  }
+  while (true) {
+    BigInt *num = bigint_random(words);
+    num->size = words;
+    // Ensure it's bits bits long and odd
+    num->digits[words - 1] &= (top == 31) ? 0xFFFFFFFF : (1u << (top + 1)) - 1;
+    num->digits[words - 1] |= 1u << top;
+    num->digits[0] |= 1;
 
-  if (true) {
-    printf("%s", sep);
-    printf("Réduction de Montgomery\n");
-    test_montgomery_reduce_once(
-        "123456789ABCDEF0123456789ABCDEF0",  // T
-        "FFFAFFFFFFFFFFFFFFFFFFFFFFFFFFFF",  // m
-        "FFFB0000000000000000000000000001",  // m_inv = –m⁻¹ mod 2^128
-        128);
-  }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Négation\n");
-    BigInt *a = bigint_from_hex("123456789ABCDEF0");
-    printf("Avant négation : ");
-    bigint_print(a);
-    bigint_negate(a);
-    printf("Après négation : ");
-    bigint_print(a);
-    bigint_free(a);
-  }
+    for (int i = 0; i < count; i++)
+      residues[i] = bigint_mod_small(num, small_primes[i]);
 
-  if (true) {
-    printf("%s", sep);
-    printf("Longueur en bits\n");
-    BigInt *a = bigint_from_hex("523456789ABCDEF0");
-    bigint_print(a);
-    printf("Nombre de bits : %d\n", bigint_bit_length(a));
-    bigint_free(a);
-  }
+    for (int delta = 0; delta < PRIME_SIEVE_SPAN; delta += 2) {
+      if (delta) {
+        bigint_add_small(num, 2);
+        if (bigint_bit_length(num) > bits) break;
+      }
 
-  if (true) {
-    printf("%s", sep);
-    printf("Multiplication de Montgomery\n");
-    test_montgomery_mul_once("0000004A3414C4C0", "000000010000000000000000",
-                             "00000080C970E2C9", 64);
-  }
+      bool composite = false;
+      for (int i = 0; i < count; i++) {
+        if (delta) {
+          residues[i] += 2;
+          if (residues[i] >= small_primes[i]) residues[i] -= small_primes[i];
+        }
+        if (residues[i] == 0) composite = true;
+      }
 
-  if (true) {
-    printf("%s", sep);
-    printf("Génération de nombres aléatoires\n");
-    int num_blocks = 4;
-    BigInt *num = bigint_random(num_blocks);
-    printf("Nombre aléatoire : ");
-    bigint_print(num);
+      if (!composite && is_probable_prime(num, iterations)) {
+        free(residues);
+        return num;
+      }
+    }
     bigint_free(num);
   }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Exponentiation modulaire\n");
-    test_montgomery_powm("0000005B3164DB0C", "3", "00000080C970E2C9", 128);
-    printf("\n");
-  }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Test de primalité\n");
-
-    char *n_hex =
-        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3"
-        "7BAE0D51C9B003D4F1F47D2F8650B991CA0B4D71E93B3280EFA4DDC0C4020593E5"
-        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763"
-        "270DC9EE539493A9793370DADA6409A68ED77E0E5930477C66DE26FCA9";
-    test_primality_with_gmp(n_hex, 10);
-  }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Vitesse du modulo avec petits modulos\n");
-
-    char *n_hex =
-        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3"
-        "7BAE0D51C9B003D4F1F47D2F8650B991CA0B4D71E93B3280EFA4DDC0C4020593E5"
-        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763"
-        "270DC9EE539493A9793370DADA6409A68ED77E0E5930477C66DE26FCA9";
-    BigInt *three = bigint_from_hex("3");
-    BigInt *five = bigint_from_hex("5");
-    BigInt *seven = bigint_from_hex("7");
-    BigInt *eleven = bigint_from_hex("11");
-    BigInt *thirteen = bigint_from_hex("13");
-    BigInt *a = bigint_from_hex(n_hex);
-
-    BigInt *result1 = bigint_mod(a, three);
-    printf("Résultat 1 : ");
-    bigint_print(result1);
-    BigInt *result2 = bigint_mod(a, five);
-    printf("Résultat 2 : ");
-    bigint_print(result2);
-    BigInt *result3 = bigint_mod(a, seven);
-    printf("Résultat 3 : ");
-    bigint_print(result3);
-    BigInt *result4 = bigint_mod(a, eleven);
-    printf("Résultat 4 : ");
-    bigint_print(result4);
-    BigInt *result5 = bigint_mod(a, thirteen);
-    printf("Résultat 5 : ");
-    bigint_print(result5);
-  }
-
-  if (true) {
-    printf("%s", sep);
-    printf("Génération de nombres premiers\n");
-    int bits = 1024;
-    int iterations = 10;
-    BigInt *prime = bigint_generate_prime(bits, iterations);
-    printf("Nombre premier généré : ");
-    bigint_print(prime);
-    bigint_free(prime);
-  }
-
-  return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,172 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Sign-magnitude : digits hold |x|, zero is never negative. The unsigned
+// functions work on magnitudes, the bigint_s* ones take the sign into account
+typedef struct {
+  uint32_t *digits;
+  int size;
+  int capacity;
+  bool negative;
+} BigInt;
+
+// Allocation and conversions
+BigInt *bigint_init(uint32_t value);
+BigInt *bigint_init_size(size_t size);
+BigInt *bigint_copy(const BigInt *num);
+void bigint_free(BigInt *num);
+void bigint_free_debug(BigInt *num, const char *nom);
+void bigint_resize(BigInt *num, int new_capacity);
+void bigint_trim(BigInt *a);
+bool bigint_is_zero(const BigInt *a);
+void bigint_print(const BigInt *num);
+BigInt *bigint_from_hex(const char *hex_str);
+BigInt *bigint_from_dec(const char *str);
+char *bigint_to_hex(const BigInt *num);
+char *bigint_to_dec(const BigInt *num);
+BigInt *bigint_read_from_file(const char *filename);
+BigInt *bigint_from_int(int64_t value);
+BigInt *bigint_random(int num_blocks);
+BigInt *bigint_random_below(const BigInt *bound);
+BigInt *bigint_random_range(const BigInt *min, const BigInt *max);
+
+// Raw limbs, least significant first, and files of the DGHV client :
+// decimal lines (.enc) and integers or arrays of pk.json and sk.json
+BigInt bigint_view(const uint32_t *words, int count, bool negative);
+BigInt *bigint_from_words(const uint32_t *words, int count, bool negative);
+const uint32_t *bigint_words(const BigInt *num, int *count);
+bool bigint_write_raw(FILE *file, const BigInt *num);
+BigInt *bigint_read_raw(FILE *file);
+BigInt **bigint_read_dec_file(const char *filename, int *count);
+bool bigint_write_dec_file(const char *filename, BigInt *const *nums,
+                           int count);
+BigInt *bigint_read_json_int(const char *filename, const char *key);
+BigInt **bigint_read_json_array(const char *filename, const char *key,
+                                int *count);
+
+// Backend and kernels in use, e.g. "native-avx2" or "gmp"
+const char *bigint_backend_name();
+int bigint_simd_level();
+const char *bigint_simd_name();
+int bigint_pool_threads();
+
+// Unsigned arithmetic on magnitudes
+BigInt *bigint_add(const BigInt *a, const BigInt *b);
+BigInt *bigint_sub(const BigInt *a, const BigInt *b);
+BigInt *bigint_mul(const BigInt *a, const BigInt *b);
+BigInt *bigint_small_mul(uint32_t a, uint32_t b);
+void bigint_add_small(BigInt *a, uint32_t value);
+void bigint_add_inplace(BigInt *a, const BigInt *b);
+void bigint_sub_inplace(BigInt *a, const BigInt *b);
+void bigint_negate(BigInt *a);
+int bigint_cmp(const BigInt *a, const BigInt *b);
+int bigint_cmp_small(const BigInt *a, uint32_t b);
+int bigint_bit_length(const BigInt *a);
+int bigint_test_bit(const BigInt *a, int bit_index);
+BigInt *bigint_subarray(const BigInt *a, int s, int l);
+BigInt *bigint_shift_left(const BigInt *a, int shift);
+void bigint_shift_left_inplace(BigInt *a, int shift);
+BigInt *bigint_div_pow2(const BigInt *n, int shift);
+void bigint_shift_right_inplace(BigInt *n);
+void bigint_divmod(const BigInt *a, const BigInt *m, BigInt **q, BigInt **r);
+BigInt *bigint_mod(const BigInt *a, const BigInt *m);
+uint32_t bigint_mod_small(const BigInt *a, uint32_t d);
+BigInt *bigint_mul_low(const BigInt *a, const BigInt *b, int k_bits);
+BigInt *bigint_modinv_pow2(const BigInt *a, int k);
+
+// Signed arithmetic
+void bigint_neg(BigInt *a);
+int bigint_scmp(const BigInt *a, const BigInt *b);
+BigInt *bigint_sadd(const BigInt *a, const BigInt *b);
+BigInt *bigint_ssub(const BigInt *a, const BigInt *b);
+BigInt *bigint_smul(const BigInt *a, const BigInt *b);
+void bigint_sdivmod(const BigInt *a, const BigInt *m, BigInt **q, BigInt **r);
+BigInt *bigint_smod(const BigInt *a, const BigInt *m);
+BigInt *bigint_smod_centered(const BigInt *a, const BigInt *m);
+
+// Word buffer kernels
+void bigint_mul_words(uint32_t *r, const uint32_t *a, int an, const uint32_t *b,
+                      int bn);
+void bigint_mul_low_words(uint32_t *r, const uint32_t *a, int an,
+                          const uint32_t *b, int bn, int k);
+uint64_t bigint_inv_word64(uint64_t a);
+
+// Barrett reduction context for repeated reductions by the same modulus
+typedef struct {
+  BigInt *m;
+  BigInt *mu;  // floor(2^(64k) / m)
+  int k;       // Number of words of m
+} bigint_barrett_ctx;
+
+bigint_barrett_ctx *bigint_barrett_init(const BigInt *m);
+void bigint_barrett_free(bigint_barrett_ctx *ctx);
+BigInt *bigint_barrett_reduce(const BigInt *a, const bigint_barrett_ctx *ctx);
+void bigint_barrett_divmod(const BigInt *a, const bigint_barrett_ctx *ctx,
+                           BigInt **q, BigInt **r);
+
+// Montgomery arithmetic
+uint32_t montgomery_n0(uint32_t n_low);
+uint64_t montgomery_n0_64(uint64_t n_low);
+void montgomery_mul_words(uint32_t *res, const uint32_t *a, const uint32_t *b,
+                          const uint32_t *n, uint32_t n0, int s, uint32_t *t);
+void montgomery_mul_words_ct(uint32_t *res, const uint32_t *a,
+                             const uint32_t *b, const uint32_t *n, uint32_t n0,
+                             int s, uint32_t *t);
+BigInt *montgomery_reduce(const BigInt *T, const BigInt *m,
+                          const BigInt *m_inv, int k_bits);
+BigInt *montgomery_mul(const BigInt *a, const BigInt *b, const BigInt *m,
+                       const BigInt *m_inv, int k_bits);
+BigInt *create_R(int k_bits);
+BigInt *montgomery_powm(const BigInt *base, const BigInt *exp,
+                        const BigInt *modulus);
+BigInt *montgomery_powm_ct(const BigInt *base, const BigInt *exp,
+                           const BigInt *modulus);
+
+// Montgomery context, computed once per modulus and reused by every
+// product and exponentiation modulo n. Not safe to share between threads.
+typedef struct bigint_mont_ctx bigint_mont_ctx;
+
+bigint_mont_ctx *bigint_mont_init(const BigInt *n);
+void bigint_mont_free(bigint_mont_ctx *ctx);
+BigInt *bigint_mont_mul(const BigInt *a, const BigInt *b, bigint_mont_ctx *ctx);
+BigInt *bigint_mont_to(const BigInt *a, bigint_mont_ctx *ctx);
+BigInt *bigint_mont_from(const BigInt *a, bigint_mont_ctx *ctx);
+BigInt *bigint_mont_powm(const BigInt *base, const BigInt *exp,
+                         bigint_mont_ctx *ctx);
+BigInt *bigint_mont_powm_ct(const BigInt *base, const BigInt *exp,
+                            bigint_mont_ctx *ctx);
+void bigint_mont_powm_batch(BigInt **res, BigInt *const *bases,
+                            BigInt *const *exps, int count,
+                            bigint_mont_ctx *ctx);
+void bigint_mont_powm_batch_ct(BigInt **res, BigInt *const *bases,
+                               BigInt *const *exps, int count,
+                               bigint_mont_ctx *ctx);
+
+// Primes
+bool is_probable_prime(BigInt *n, int iterations);
+bool is_trivial_composite(BigInt *n);
+BigInt *bigint_generate_prime(int bits, int iterations);
+
+// Conversions from and to GMP, available when gmp.h is included first
+#ifdef __GNU_MP__
+static inline void bigint_to_mpz(mpz_t z, const BigInt *a) {
+  mpz_import(z, a->size, -1, sizeof(uint32_t), 0, 0, a->digits);
+  if (a->negative) mpz_neg(z, z);
+}
+
+static inline BigInt *bigint_from_mpz(const mpz_t z) {
+  size_t count = (mpz_sizeinbase(z, 2) + 31) / 32;
+  BigInt *num = bigint_init_size(count ? count : 1);
+  mpz_export(num->digits, &count, -1, sizeof(uint32_t), 0, 0, z);
+  num->size = count ? count : 1;
+  num->negative = mpz_sgn(z) < 0;
+  return num;
+}
+#endif
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef BIGINT_FIXED_H
+#define BIGINT_FIXED_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigInt.h"
+
+// Fixed-width integers for operand sizes known at compile time (DGHV uses
+// ETA = 512 and GAMMA = 8192 bits). Digits live in the struct, on the stack,
+// always on all the words : no allocation, no size bookkeeping and no trim.
+// BIGINT_FIXED_DEFINE(bits) generates the type bigint<bits> and its
+// functions, the kernels below are inlined with the width as a constant so
+// that the compiler unrolls them.
+
+// Kernels work on 64-bit words with 128-bit products, four times fewer
+// multiplications than the 32-bit words of BigInt. Up to this number of
+// words, products are unrolled schoolbook loops; wider ones go through the
+// library kernels (Karatsuba, IFMA).
+#define BIGINT_FIXED_UNROLL_WORDS 16
+
+#define BIGINT_FIXED_INLINE static inline __attribute__((always_inline))
+
+typedef unsigned __int128 bigint_fixed_dword;
+typedef uint32_t bigint_fixed_u32 __attribute__((may_alias));
+
+// r = a + b on n words, returns the carry
+BIGINT_FIXED_INLINE uint64_t bigint_fixed_add(uint64_t *r, const uint64_t *a,
+                                              const uint64_t *b, int n) {
+  uint64_t carry = 0;
+#pragma GCC unroll 16
+  for (int i = 0; i < n; i++) {
+    bigint_fixed_dword sum = (bigint_fixed_dword)a[i] + b[i] + carry;
+    r[i] = (uint64_t)sum;
+    carry = (uint64_t)(sum >> 64);
+  }
+  return carry;
+}
+
+// r = a - b on n words, returns the borrow
+BIGINT_FIXED_INLINE uint64_t bigint_fixed_sub(uint64_t *r, const uint64_t *a,
+                                              const uint64_t *b, int n) {
+  uint64_t borrow = 0;
+#pragma GCC unroll 16
+  for (int i = 0; i < n; i++) {
+    bigint_fixed_dword diff = (bigint_fixed_dword)a[i] - b[i] - borrow;
+    r[i] = (uint64_t)diff;
+    borrow = (uint64_t)(diff >> 64) & 1;
+  }
+  return borrow;
+}
+
+BIGINT_FIXED_INLINE int bigint_fixed_cmp(const uint64_t *a, const uint64_t *b,
+                                         int n) {
+  for (int i = n - 1; i >= 0; i--)
+    if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+  return 0;
+}
+
+// r = b if mask is all ones, kept otherwise
+BIGINT_FIXED_INLINE void bigint_fixed_select(uint64_t *r, const uint64_t *b,
+                                             uint64_t mask, int n) {
+#pragma GCC unroll 16
+  for (int i = 0; i < n; i++) r[i] = (b[i] & mask) | (r[i] & ~mask);
+}
+
+// r = a * b on an + bn words, r distinct from a and b
+BIGINT_FIXED_INLINE void bigint_fixed_mul(uint64_t *r, const uint64_t *a,
+                                          int an, const uint64_t *b, int bn) {
+  if (an > BIGINT_FIXED_UNROLL_WORDS || bn > BIGINT_FIXED_UNROLL_WORDS) {
+    bigint_mul_words((bigint_fixed_u32 *)r, (const bigint_fixed_u32 *)a,
+                     2 * an, (const bigint_fixed_u32 *)b, 2 * bn);
+    return;
+  }
+  for (int i = 0; i < bn; i++) r[i] = 0;
+  for (int i = 0; i < an; i++) {
+    uint64_t carry = 0;
+#pragma GCC unroll 16
+    for (int j = 0; j < bn; j++) {
+      bigint_fixed_dword t =
+          (bigint_fixed_dword)a[i] * b[j] + r[i + j] + carry;
+      r[i + j] = (uint64_t)t;
+      carry = (uint64_t)(t >> 64);
+    }
+    r[i + bn] = carry;
+  }
+}
+
+// r = a * b mod 2^(64n), a on n words and b on bn <= n words
+BIGINT_FIXED_INLINE void bigint_fixed_mul_low(uint64_t *r, const uint64_t *a,
+                                              const uint64_t *b, int n,
+                                              int bn) {
+  if (n > BIGINT_FIXED_UNROLL_WORDS) {
+    bigint_mul_low_words((bigint_fixed_u32 *)r, (const bigint_fixed_u32 *)a,
+                         2 * n, (const bigint_fixed_u32 *)b, 2 * bn, 2 * n);
+    return;
+  }
+  for (int i = 0; i < n; i++) r[i] = 0;
+  for (int i = 0; i < bn; i++) {
+    uint64_t carry = 0;
+#pragma GCC unroll 16
+    for (int j = 0; j < n - i; j++) {
+      bigint_fixed_dword t =
+          (bigint_fixed_dword)b[i] * a[j] + r[i + j] + carry;
+      r[i + j] = (uint64_t)t;
+      carry = (uint64_t)(t >> 64);
+    }
+  }
+}
+
+// CIOS Montgomery product on n words, t is a scratch of n + 2 words.
+// The final subtraction is a masked select, without branches.
+BIGINT_FIXED_INLINE void bigint_fixed_mont_mul(uint64_t *res,
+                                               const uint64_t *a,
+                                               const uint64_t *b,
+                                               const uint64_t *m, uint64_t n0,
+                                               int n, uint64_t *t) {
+  for (int i = 0; i < n + 2; i++) t[i] = 0;
+  for (int i = 0; i < n; i++) {
+    // t += a * b[i]
+    uint64_t carry = 0;
+#pragma GCC unroll 16
+    for (int j = 0; j < n; j++) {
+      bigint_fixed_dword sum = (bigint_fixed_dword)a[j] * b[i] + t[j] + carry;
+      t[j] = (uint64_t)sum;
+      carry = (uint64_t)(sum >> 64);
+    }
+    bigint_fixed_dword sum = (bigint_fixed_dword)t[n] + carry;
+    t[n] = (uint64_t)sum;
+    t[n + 1] = (uint64_t)(sum >> 64);
+
+    // t = (t + q * m) / 2^64
+    uint64_t q = t[0] * n0;
+    carry = (uint64_t)(((bigint_fixed_dword)q * m[0] + t[0]) >> 64);
+#pragma GCC unroll 16
+    for (int j = 1; j < n; j++) {
+      sum = (bigint_fixed_dword)q * m[j] + t[j] + carry;
+      t[j - 1] = (uint64_t)sum;
+      carry = (uint64_t)(sum >> 64);
+    }
+    sum = (bigint_fixed_dword)t[n] + carry;
+    t[n - 1] = (uint64_t)sum;
+    t[n] = t[n + 1] + (uint64_t)(sum >> 64);
+  }
+
+  // t < 2m : keep t - m unless it borrowed
+  uint64_t borrow = bigint_fixed_sub(res, t, m, n);
+  uint64_t keep_t = -(borrow & (t[n] ^ 1));
+  bigint_fixed_select(res, t, keep_t, n);
+}
+
+// Barrett reduction (HAC 14.42 with b = 2^64) of x on 2n words by m on n
+// words, with mu = floor(2^(128n) / m) on n + 1 words and m[n - 1] != 0
+BIGINT_FIXED_INLINE void bigint_fixed_barrett(uint64_t *r, const uint64_t *x,
+                                              const uint64_t *m,
+                                              const uint64_t *mu, int n,
+                                              uint64_t *scratch) {
+  // q = ((x >> 64(n - 1)) * mu) >> 64(n + 1), at most n + 1 words
+  uint64_t *prod = scratch;            // 2n + 2 words
+  uint64_t *qm = scratch + 2 * n + 2;  // n + 1 words
+  uint64_t *rem = scratch + 3 * n + 3; // n + 1 words
+  bigint_fixed_mul(prod, x + n - 1, n + 1, mu, n + 1);
+  const uint64_t *q = prod + n + 1;
+
+  // r = (x - q * m) mod 2^(64(n + 1)) < 3m
+  bigint_fixed_mul_low(qm, q, m, n + 1, n);
+  bigint_fixed_sub(rem, x, qm, n + 1);
+  for (int k = 0; k < 2; k++) {
+    uint64_t top = rem[n];
+    uint64_t borrow = bigint_fixed_sub(qm, rem, m, n);
+    uint64_t ge = -(uint64_t)((top != 0) | (borrow == 0));
+    bigint_fixed_select(rem, qm, ge, n);
+    rem[n] = top - (ge & borrow);
+  }
+  for (int i = 0; i < n; i++) r[i] = rem[i];
+}
+
+#define BIGINT_FIXED_DEFINE(bits)                                            \
+  typedef struct {                                                           \
+    uint64_t words[(bits) / 64];                                             \
+  } bigint##bits;                                                            \
+                                                                             \
+  /* Barrett context : m must use its top word */                            \
+  typedef struct {                                                           \
+    bigint##bits m;                                                          \
+    uint64_t mu[(bits) / 64 + 1];                                            \
+  } bigint##bits##_barrett_ctx;                                              \
+                                                                             \
+  static inline void bigint##bits##_set_u64(bigint##bits *r, uint64_t v) {   \
+    memset(r->words, 0, sizeof(r->words));                                   \
+    r->words[0] = v;                                                         \
+  }                                                                          \
+                                                                             \
+  /* Magnitude of a, false when it does not fit */                           \
+  static inline bool bigint##bits##_from_bigint(bigint##bits *r,             \
+                                                const BigInt *a) {           \
+    int size = a->size;                                                      \
+    while (size > 1 && a->digits[size - 1] == 0) size--;                     \
+    if (size > (bits) / 32) return false;                                    \
+    memset(r->words, 0, sizeof(r->words));                                   \
+    memcpy(r->words, a->digits, sizeof(uint32_t) * size);                    \
+    return true;                                                             \
+  }                                                                          \
+                                                                             \
+  static inline BigInt *bigint##bits##_to_bigint(const bigint##bits *a) {    \
+    BigInt *r = bigint_init_size((bits) / 32);                               \
+    memcpy(r->digits, a->words, sizeof(a->words));                           \
+    r->size = (bits) / 32;                                                   \
+    bigint_trim(r);                                                          \
+    return r;                                                                \
+  }                                                                          \
+                                                                             \
+  static inline bool bigint##bits##_is_zero(const bigint##bits *a) {         \
+    uint64_t acc = 0;                                                        \
+    for (int i = 0; i < (bits) / 64; i++) acc |= a->words[i];                \
+    return acc == 0;                                                         \
+  }                                                                          \
+                                                                             \
+  static inline int bigint##bits##_cmp(const bigint##bits *a,                \
+                                       const bigint##bits *b) {              \
+    return bigint_fixed_cmp(a->words, b->words, (bits) / 64);                \
+  }                                                                          \
+                                                                             \
+  /* r = a + b mod 2^bits, returns the carry */                              \
+  static inline uint64_t bigint##bits##_add(                                 \
+      bigint##bits *r, const bigint##bits *a, const bigint##bits *b) {       \
+    return bigint_fixed_add(r->words, a->words, b->words, (bits) / 64);      \
+  }                                                                          \
+                                                                             \
+  /* r = a - b mod 2^bits, returns the borrow */                             \
+  static inline uint64_t bigint##bits##_sub(                                 \
+      bigint##bits *r, const bigint##bits *a, const bigint##bits *b) {       \
+    return bigint_fixed_sub(r->words, a->words, b->words, (bits) / 64);      \
+  }                                                                          \
+                                                                             \
+  /* r = a * b * 2^(-bits) mod m for a, b < m and m odd, with */             \
+  /* n0 = montgomery_n0_64(m->words[0]) */                                   \
+  static inline void bigint##bits##_mont_mul(                                \
+      bigint##bits *r, const bigint##bits *a, const bigint##bits *b,         \
+      const bigint##bits *m, uint64_t n0) {                                  \
+    uint64_t t[(bits) / 64 + 2];                                             \
+    bigint_fixed_mont_mul(r->words, a->words, b->words, m->words, n0,        \
+                          (bits) / 64, t);                                   \
+  }                                                                          \
+                                                                             \
+  /* m uses the top word and is not 2^(bits - 64) : the mu of that m, */     \
+  /* 2^(bits + 64), would not fit the n + 1 words of ctx->mu */              \
+  static inline bool bigint##bits##_barrett_init(                            \
+      bigint##bits##_barrett_ctx *ctx, const BigInt *m) {                    \
+    int n = (bits) / 64;                                                     \
+    if (!bigint##bits##_from_bigint(&ctx->m, m) || ctx->m.words[n - 1] == 0) \
+      return false;                                                          \
+    bool power = ctx->m.words[n - 1] == 1;                                   \
+    for (int i = 0; power && i < n - 1; i++) power = ctx->m.words[i] == 0;   \
+    if (power) return false;                                                 \
+    BigInt *pow = bigint_init(1);                                            \
+    bigint_shift_left_inplace(pow, 128 * n);                                 \
+    BigInt *q, *rem;                                                         \
+    bigint_divmod(pow, m, &q, &rem);                                         \
+    memset(ctx->mu, 0, sizeof(ctx->mu));                                     \
+    size_t size = sizeof(uint32_t) * q->size;                                \
+    if (size > sizeof(ctx->mu)) size = sizeof(ctx->mu);                      \
+    memcpy(ctx->mu, q->digits, size);                                        \
+    bigint_free(pow);                                                        \
+    bigint_free(q);                                                          \
+    bigint_free(rem);                                                        \
+    return true;                                                             \
+  }                                                                          \
+                                                                             \
+  /* r = a mod m for a on an 32-bit digits, folded by chunks of bits bits */ \
+  static inline void bigint##bits##_reduce(                                  \
+      bigint##bits *r, const uint32_t *a, int an,                            \
+      const bigint##bits##_barrett_ctx *ctx) {                               \
+    enum { n = (bits) / 64, chunk = (bits) / 32 };                           \
+    uint64_t x[2 * n], scratch[4 * n + 4];                                   \
+    int top = an % chunk ? an % chunk : chunk;                               \
+    memset(x, 0, sizeof(x));                                                 \
+    memcpy(x, a + an - top, sizeof(uint32_t) * top);                         \
+    bigint_fixed_barrett(r->words, x, ctx->m.words, ctx->mu, n, scratch);    \
+    for (int i = an - top - chunk; i >= 0; i -= chunk) {                     \
+      memcpy(x, a + i, sizeof(uint32_t) * chunk);                            \
+      memcpy(x + n, r->words, sizeof(r->words));                             \
+      bigint_fixed_barrett(r->words, x, ctx->m.words, ctx->mu, n, scratch);  \
+    }                                                                        \
+  }                                                                          \
+                                                                             \
+  /* r = |a| mod m, same as bigint_mod */                                    \
+  static inline void bigint##bits##_mod(                                     \
+      bigint##bits *r, const BigInt *a,                                      \
+      const bigint##bits##_barrett_ctx *ctx) {                               \
+    bigint##bits##_reduce(r, a->digits, a->size, ctx);                       \
+  }
+
+// bigint<bits>_mul : full product of two bigint<bits> into bigint<wide>
+#define BIGINT_FIXED_MUL(bits, wide)                                         \
+  _Static_assert((wide) == 2 * (bits), "bigint" #wide " != 2 * " #bits);     \
+  static inline void bigint##bits##_mul(                                     \
+      bigint##wide *r, const bigint##bits *a, const bigint##bits *b) {       \
+    bigint_fixed_mul(r->words, a->words, (bits) / 64, b->words,              \
+                     (bits) / 64);                                           \
+  }
+
+// bigint<bits>_mul_<small> : product mod 2^bits by a narrower operand
+#define BIGINT_FIXED_MUL_LOW(bits, small)                                    \
+  _Static_assert((small) <= (bits), #small " > " #bits);                     \
+  static inline void bigint##bits##_mul_##small(                             \
+      bigint##bits *r, const bigint##bits *a, const bigint##small *b) {      \
+    bigint_fixed_mul_low(r->words, a->words, b->words, (bits) / 64,          \
+                         (small) / 64);                                      \
+  }
+
+// DGHV sizes : secret key p (ETA), ciphertexts (GAMMA) and their products
+BIGINT_FIXED_DEFINE(512)
+BIGINT_FIXED_DEFINE(1024)
+BIGINT_FIXED_DEFINE(8192)
+BIGINT_FIXED_DEFINE(16384)
+BIGINT_FIXED_MUL(512, 1024)
+BIGINT_FIXED_MUL(8192, 16384)
+BIGINT_FIXED_MUL_LOW(8192, 512)
+
+#endif
@@ -0,0 +1,1339 @@
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bigInt.h"
+#include "bigIntFixed.h"
+
+void test_modinv_with_gmp(const char *m_hex, int k) {
+  mpz_t gmp_m, gmp_result;
+  mpz_init(gmp_m);
+  mpz_init(gmp_result);
+
+  BigInt *m = bigint_from_hex(m_hex);
+  mpz_set_str(gmp_m, m_hex, 16);
+
+  mpz_t gmp_mod;
+  mpz_init(gmp_mod);
+  mpz_ui_pow_ui(gmp_mod, 2, k);  // 2^k
+
+  if (mpz_invert(gmp_result, gmp_m, gmp_mod) == 0) {
+    printf("Aucun inverse modulaire n'existe.\n");
+    return;
+  }
+
+  BigInt *result = bigint_modinv_pow2(m, k);
+
+  printf("Résultat GMP     : 0x");
+  gmp_printf("%Zx\n", gmp_result);
+
+  printf("Résultat BigInt  : 0x");
+  for (int i = result->size - 1; i >= 0; i--) {
+    printf("%08X", result->digits[i]);
+  }
+  printf("\n");
+
+  bigint_free(m);
+  bigint_free(result);
+  mpz_clear(gmp_mod);
+  mpz_clear(gmp_m);
+  mpz_clear(gmp_result);
+}
+
+void test_montgomery_reduce_once(const char *hex_T, const char *hex_m,
+                                 const char *hex_m_inv, int k_bits) {
+  BigInt *T = bigint_from_hex(hex_T);
+  BigInt *m = bigint_from_hex(hex_m);
+  BigInt *m_inv = bigint_from_hex(hex_m_inv);
+
+  BigInt *res_my = montgomery_reduce(T, m, m_inv, k_bits);
+
+  mpz_t G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t;
+  mpz_inits(G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t, NULL);
+
+  mpz_set_str(G_T, hex_T, 16);
+  mpz_set_str(G_m, hex_m, 16);
+  mpz_set_str(G_m_inv, hex_m_inv, 16);
+
+  mpz_ui_pow_ui(G_R, 2, k_bits);
+
+  mpz_mul(G_u, G_T, G_m_inv);
+  mpz_mod(G_u, G_u, G_R);
+
+  mpz_mul(G_sum, G_u, G_m);
+  mpz_add(G_sum, G_sum, G_T);
+
+  mpz_tdiv_q_2exp(G_t, G_sum, k_bits);
+
+  mpz_mod(G_t, G_t, G_m);
+  char *str_gmp = mpz_get_str(NULL, 16, G_t);
+
+  printf("T       = 0x%s\n", hex_T);
+  printf("m       = 0x%s\n", hex_m);
+  printf("m_inv   = 0x%s\n", hex_m_inv);
+  printf("k_bits  = %d\n", k_bits);
+  printf("résultat attendu GMP = 0x%s\n", str_gmp);
+  printf("résultat BigInt      = ");
+  bigint_print(res_my);
+
+  free(str_gmp);
+  bigint_free(T);
+  bigint_free(m);
+  bigint_free(m_inv);
+  bigint_free(res_my);
+  mpz_clears(G_T, G_m, G_m_inv, G_R, G_u, G_sum, G_t, NULL);
+}
+
+void test_montgomery_mul_once(const char *hex_a, const char *hex_b,
+                              const char *hex_m, int k_bits) {
+  BigInt *a = bigint_from_hex(hex_a);
+  BigInt *b = bigint_from_hex(hex_b);
+  BigInt *m = bigint_from_hex(hex_m);
+
+  BigInt *minv = bigint_modinv_pow2(m, k_bits);
+  bigint_negate(minv);
+
+  BigInt *res_my = montgomery_mul(a, b, m, minv, k_bits);
+
+  mpz_t G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res;
+  mpz_inits(G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res, NULL);
+
+  mpz_set_str(G_a, hex_a, 16);
+  mpz_set_str(G_b, hex_b, 16);
+  mpz_set_str(G_m, hex_m, 16);
+
+  mpz_ui_pow_ui(G_R, 2, k_bits);
+
+  if (mpz_invert(G_minv, G_m, G_R) == 0) {
+    fprintf(stderr, "mpz_invert failed\n");
+    exit(1);
+  }
+  mpz_neg(G_minv, G_minv);
+  mpz_mod(G_minv, G_minv, G_R);
+
+  mpz_mul(G_T, G_a, G_b);
+
+  mpz_mul(G_u, G_T, G_minv);
+  mpz_mod(G_u, G_u, G_R);
+
+  mpz_mul(G_sum, G_u, G_m);
+  mpz_add(G_sum, G_sum, G_T);
+
+  mpz_tdiv_q_2exp(G_t, G_sum, k_bits);
+  mpz_mod(G_res, G_t, G_m);
+
+  char *str_gmp = mpz_get_str(NULL, 16, G_res);
+
+  printf("a       = 0x%s\n", hex_a);
+  printf("b       = 0x%s\n", hex_b);
+  printf("m       = 0x%s\n", hex_m);
+  printf("k_bits  = %d\n", k_bits);
+  printf("Résultat GMP    = 0x%s\n", str_gmp);
+  printf("Résultat BigInt = ");
+  bigint_print(res_my);
+
+  free(str_gmp);
+  bigint_free(a);
+  bigint_free(b);
+  bigint_free(m);
+  bigint_free(minv);
+  bigint_free(res_my);
+  mpz_clears(G_a, G_b, G_m, G_minv, G_R, G_T, G_u, G_sum, G_t, G_res, NULL);
+}
+
+void test_montgomery_powm(const char *hex_base, const char *hex_exp,
+                          const char *hex_mod, int k_bits) {
+  BigInt *B = bigint_from_hex(hex_base);
+  BigInt *E = bigint_from_hex(hex_exp);
+  BigInt *M = bigint_from_hex(hex_mod);
+
+  BigInt *R_my = montgomery_powm(B, E, M);
+  BigInt *R_ct = montgomery_powm_ct(B, E, M);
+
+  mpz_t gB, gE, gM, gR;
+  mpz_inits(gB, gE, gM, gR, NULL);
+  mpz_set_str(gB, hex_base, 16);
+  mpz_set_str(gE, hex_exp, 16);
+  mpz_set_str(gM, hex_mod, 16);
+  mpz_powm(gR, gB, gE, gM);
+
+  char *s_gmp = mpz_get_str(NULL, 16, gR);
+
+  printf("base       = 0x%s\n", hex_base);
+  printf("exp        = 0x%s\n", hex_exp);
+  printf("mod        = 0x%s\n", hex_mod);
+  printf("k_bits     = %d\n", k_bits);
+  printf("résultat GMP    = 0x%s\n", s_gmp);
+  printf("résultat BigInt = ");
+  bigint_print(R_my);
+  printf("résultat BigInt (temps constant) = ");
+  bigint_print(R_ct);
+
+  free(s_gmp);
+  bigint_free(B);
+  bigint_free(E);
+  bigint_free(M);
+  bigint_free(R_my);
+  bigint_free(R_ct);
+  mpz_clears(gB, gE, gM, gR, NULL);
+}
+
+void test_primality_with_gmp(const char *hex_n, int iterations) {
+  mpz_t gmp_n;
+  mpz_init(gmp_n);
+  mpz_set_str(gmp_n, hex_n, 16);
+  BigInt *n = bigint_from_hex(hex_n);
+
+  int is_prime = mpz_probab_prime_p(gmp_n, iterations);
+  int is_prime_bigint = is_probable_prime(n, iterations);
+
+  printf("Résultat GMP : %s\n", is_prime ? "Premier" : "Non premier");
+  printf("Résultat BigInt : %s\n", is_prime_bigint ? "Premier" : "Non premier");
+
+  mpz_clear(gmp_n);
+}
+
+// Random 32-bit word from rand()
+static uint32_t fuzz_word() {
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// Random operand of words words with a random shape : uniform, all ones,
+// power of two or single high bit over random low words
+static BigInt *fuzz_operand(int words) {
+  BigInt *num = bigint_init_size(words);
+  num->size = words;
+  int shape = rand() % 6;
+  for (int i = 0; i < words; i++) {
+    num->digits[i] = (shape == 3) ? 0xFFFFFFFF : (shape == 4) ? 0 : fuzz_word();
+  }
+  if (shape == 4) num->digits[words - 1] = 1u << (rand() % 32);
+  if (shape == 5) num->digits[words - 1] = 1;
+  bigint_trim(num);
+  return num;
+}
+
+// Operand sizes in words, biased towards the Karatsuba and Montgomery
+// thresholds and the DGHV sizes (512 and 8192 bits)
+static int fuzz_words() {
+  static const int sizes[] = {1,  2,  3,  4,  7,   8,   15,  16,  17,  31,
+                              32, 33, 48, 63, 64,  65,  96,  127, 128, 129,
+                              255, 256, 257, 511, 512, 1024, 2048, 8192};
+  int count = sizeof(sizes) / sizeof(sizes[0]);
+  // Large sizes are rarer to keep each round fast
+  int idx = rand() % count;
+  if (sizes[idx] > 256 && rand() % 4) idx = rand() % 20;
+  return sizes[idx];
+}
+
+static int fuzz_check(const char *op, const BigInt *got, const mpz_t expected,
+                      const BigInt *a, const BigInt *b) {
+  mpz_t z;
+  mpz_init(z);
+  bigint_to_mpz(z, got);
+  int fail = mpz_cmp(z, expected) != 0;
+  if (fail) {
+    printf("Échec %s\na = ", op);
+    bigint_print(a);
+    printf("b = ");
+    bigint_print(b);
+    gmp_printf("GMP    : 0x%Zx\nBigInt : ", expected);
+    bigint_print(got);
+  }
+  mpz_clear(z);
+  return fail;
+}
+
+// Fixed-width types : add, sub, Montgomery product and Barrett reduction of
+// operands of the full width, modulus with its top word set
+#define FUZZ_FIXED(bits)                                                     \
+  static int fuzz_fixed##bits() {                                            \
+    int words = (bits) / 32, failures = 0;                                   \
+    BigInt *a = fuzz_operand(words), *b = fuzz_operand(words);               \
+    BigInt *m = fuzz_operand(words);                                         \
+    BigInt *wide = fuzz_operand(1 + rand() % (3 * words));                   \
+    bigint_resize(m, words);                                                 \
+    for (int i = m->size; i < words; i++) m->digits[i] = 0;                  \
+    m->size = words;                                                         \
+    m->digits[words - 1] |= 1u << (rand() % 32);                             \
+    m->digits[0] |= 1;                                                       \
+    mpz_t za, zb, zm, zr, zmod;                                              \
+    mpz_inits(za, zb, zm, zr, zmod, NULL);                                   \
+    bigint_to_mpz(za, a);                                                    \
+    bigint_to_mpz(zb, b);                                                    \
+    bigint_to_mpz(zm, m);                                                    \
+    mpz_setbit(zmod, bits);                                                  \
+                                                                             \
+    bigint##bits fa, fb, fm, fr;                                             \
+    bigint##bits##_from_bigint(&fa, a);                                      \
+    bigint##bits##_from_bigint(&fb, b);                                      \
+    bigint##bits##_from_bigint(&fm, m);                                      \
+    BigInt *r;                                                               \
+                                                                             \
+    bigint##bits##_add(&fr, &fa, &fb);                                       \
+    mpz_add(zr, za, zb);                                                     \
+    mpz_mod(zr, zr, zmod);                                                   \
+    r = bigint##bits##_to_bigint(&fr);                                       \
+    failures += fuzz_check("bigint" #bits "_add", r, zr, a, b);              \
+    bigint_free(r);                                                          \
+                                                                             \
+    bigint##bits##_sub(&fr, &fa, &fb);                                       \
+    mpz_sub(zr, za, zb);                                                     \
+    mpz_mod(zr, zr, zmod);                                                   \
+    r = bigint##bits##_to_bigint(&fr);                                       \
+    failures += fuzz_check("bigint" #bits "_sub", r, zr, a, b);              \
+    bigint_free(r);                                                          \
+                                                                             \
+    bigint##bits##_barrett_ctx ctx;                                          \
+    bigint##bits##_barrett_init(&ctx, m);                                    \
+    bigint##bits##_mod(&fr, wide, &ctx);                                     \
+    bigint_to_mpz(zr, wide);                                                 \
+    mpz_mod(zr, zr, zm);                                                     \
+    r = bigint##bits##_to_bigint(&fr);                                       \
+    failures += fuzz_check("bigint" #bits "_mod", r, zr, wide, m);           \
+    bigint_free(r);                                                          \
+                                                                             \
+    /* a * b / 2^bits mod m, for a, b < m */                                 \
+    bigint##bits##_mod(&fa, a, &ctx);                                        \
+    bigint##bits##_mod(&fb, b, &ctx);                                        \
+    bigint##bits##_mont_mul(&fr, &fa, &fb, &fm,                              \
+                            montgomery_n0_64(fm.words[0]));                  \
+    mpz_mod(za, za, zm);                                                     \
+    mpz_mod(zb, zb, zm);                                                     \
+    mpz_invert(zmod, zmod, zm);                                              \
+    mpz_mul(zr, za, zb);                                                     \
+    mpz_mul(zr, zr, zmod);                                                   \
+    mpz_mod(zr, zr, zm);                                                     \
+    r = bigint##bits##_to_bigint(&fr);                                       \
+    failures += fuzz_check("bigint" #bits "_mont_mul", r, zr, a, b);         \
+    bigint_free(r);                                                          \
+                                                                             \
+    /* 2^(bits - 64) is the one modulus with the top word set that is */     \
+    /* refused : its mu would not fit */                                     \
+    BigInt *power = bigint_init(1);                                          \
+    bigint_shift_left_inplace(power, (bits) - 64);                           \
+    if (bigint##bits##_barrett_init(&ctx, power)) {                          \
+      printf("Échec bigint" #bits "_barrett_init : 2^%d accepté\n",          \
+             (bits) - 64);                                                   \
+      failures++;                                                            \
+    }                                                                        \
+    bigint_free(power);                                                      \
+                                                                             \
+    mpz_clears(za, zb, zm, zr, zmod, NULL);                                  \
+    bigint_free(a);                                                          \
+    bigint_free(b);                                                          \
+    bigint_free(m);                                                          \
+    bigint_free(wide);                                                       \
+    return failures;                                                         \
+  }
+
+FUZZ_FIXED(512)
+FUZZ_FIXED(8192)
+
+// Products of the fixed-width types
+static int fuzz_fixed_mul() {
+  int failures = 0;
+  mpz_t za, zb, zr;
+  mpz_inits(za, zb, zr, NULL);
+
+  BigInt *a = fuzz_operand(16), *b = fuzz_operand(16);
+  bigint512 fa, fb;
+  bigint1024 fr;
+  bigint512_from_bigint(&fa, a);
+  bigint512_from_bigint(&fb, b);
+  bigint512_mul(&fr, &fa, &fb);
+  bigint_to_mpz(za, a);
+  bigint_to_mpz(zb, b);
+  mpz_mul(zr, za, zb);
+  BigInt *r = bigint1024_to_bigint(&fr);
+  failures += fuzz_check("bigint512_mul", r, zr, a, b);
+  bigint_free(r);
+  bigint_free(b);
+
+  // c = p * q mod 2^8192 as in DGHV encryption
+  BigInt *c = fuzz_operand(256);
+  bigint8192 fc, fp;
+  bigint8192_from_bigint(&fc, c);
+  bigint8192_mul_512(&fp, &fc, &fa);
+  bigint_to_mpz(zb, c);
+  mpz_mul(zr, za, zb);
+  mpz_fdiv_r_2exp(zr, zr, 8192);
+  r = bigint8192_to_bigint(&fp);
+  failures += fuzz_check("bigint8192_mul_512", r, zr, a, c);
+  bigint_free(r);
+
+  bigint16384 fw;
+  bigint8192_mul(&fw, &fc, &fp);
+  bigint_to_mpz(za, r = bigint8192_to_bigint(&fp));
+  bigint_free(r);
+  mpz_mul(zr, za, zb);
+  r = bigint16384_to_bigint(&fw);
+  failures += fuzz_check("bigint8192_mul", r, zr, a, c);
+  bigint_free(r);
+
+  bigint_free(a);
+  bigint_free(c);
+  mpz_clears(za, zb, zr, NULL);
+  return failures;
+}
+
+// Decimal and hexadecimal strings against mpz_get_str, parsing back and
+// raw binary round trip
+static int fuzz_radix(const BigInt *a, const mpz_t za) {
+  int failures = 0;
+  static const int bases[] = {10, 16};
+  for (int i = 0; i < 2; i++) {
+    char *got = bases[i] == 10 ? bigint_to_dec(a) : bigint_to_hex(a);
+    char *expected = mpz_get_str(NULL, bases[i], za);
+    if (strcmp(got, expected) != 0) {
+      printf("Échec to_%s\na = ", bases[i] == 10 ? "dec" : "hex");
+      bigint_print(a);
+      failures++;
+    }
+    BigInt *back = bases[i] == 10 ? bigint_from_dec(got) : bigint_from_hex(got);
+    failures += fuzz_check(bases[i] == 10 ? "from_dec" : "from_hex", back, za,
+                           a, back);
+    bigint_free(back);
+    free(got);
+    free(expected);
+  }
+
+  FILE *file = tmpfile();
+  bigint_write_raw(file, a);
+  rewind(file);
+  BigInt *back = bigint_read_raw(file);
+  fclose(file);
+  failures += fuzz_check("write_raw/read_raw", back, za, a, back);
+  bigint_free(back);
+  return failures;
+}
+
+// Differential fuzzer : random operands of many sizes through the bigint_*
+// API, each result checked against GMP. Returns the number of failures
+int bigint_fuzz(int iterations, unsigned int seed) {
+  srand(seed);
+  printf("Fuzzing : %d itérations, graine %u, noyaux %s\n", iterations, seed,
+         bigint_simd_name());
+
+  int failures = 0;
+  mpz_t za, zb, zr, zq, zm;
+  mpz_inits(za, zb, zr, zq, zm, NULL);
+
+  for (int it = 0; it < iterations; it++) {
+    BigInt *a = fuzz_operand(fuzz_words());
+    BigInt *b = fuzz_operand(fuzz_words());
+    bigint_to_mpz(za, a);
+    bigint_to_mpz(zb, b);
+    BigInt *r, *q;
+
+    r = bigint_add(a, b);
+    mpz_add(zr, za, zb);
+    failures += fuzz_check("add", r, zr, a, b);
+    bigint_free(r);
+
+    if (bigint_cmp(a, b) >= 0) {
+      r = bigint_sub(a, b);
+      mpz_sub(zr, za, zb);
+    } else {
+      r = bigint_sub(b, a);
+      mpz_sub(zr, zb, za);
+    }
+    failures += fuzz_check("sub", r, zr, a, b);
+    bigint_free(r);
+
+    int shift = rand() % 200;
+    r = bigint_shift_left(a, shift);
+    mpz_mul_2exp(zr, za, shift);
+    failures += fuzz_check("shift_left", r, zr, a, b);
+    bigint_free(r);
+    r = bigint_div_pow2(a, shift);
+    mpz_fdiv_q_2exp(zr, za, shift);
+    failures += fuzz_check("div_pow2", r, zr, a, b);
+    bigint_free(r);
+
+    r = bigint_mul(a, b);
+    mpz_mul(zr, za, zb);
+    failures += fuzz_check("mul", r, zr, a, b);
+    bigint_free(r);
+
+    int k = 1 + rand() % (32 * (a->size + b->size));
+    r = bigint_mul_low(a, b, k);
+    mpz_fdiv_r_2exp(zr, zr, k);
+    failures += fuzz_check("mul_low", r, zr, a, b);
+    bigint_free(r);
+
+    if (bigint_cmp_small(b, 0) != 0) {
+      bigint_divmod(a, b, &q, &r);
+      mpz_tdiv_qr(zq, zr, za, zb);
+      failures += fuzz_check("divmod (quotient)", q, zq, a, b);
+      failures += fuzz_check("divmod (reste)", r, zr, a, b);
+      bigint_free(q);
+      bigint_free(r);
+
+      bigint_barrett_ctx *barrett = bigint_barrett_init(b);
+      r = bigint_barrett_reduce(a, barrett);
+      failures += fuzz_check("barrett", r, zr, a, b);
+      bigint_free(r);
+      bigint_barrett_divmod(a, barrett, &q, &r);
+      failures += fuzz_check("barrett_divmod (quotient)", q, zq, a, b);
+      failures += fuzz_check("barrett_divmod (reste)", r, zr, a, b);
+      bigint_free(q);
+      bigint_free(r);
+      bigint_barrett_free(barrett);
+    }
+
+    uint32_t d = fuzz_word() | 1;
+    mpz_set_ui(zr, mpz_fdiv_ui(za, d));
+    r = bigint_init(bigint_mod_small(a, d));
+    failures += fuzz_check("mod_small", r, zr, a, b);
+    bigint_free(r);
+
+    // Odd operands : inverse mod 2^k, Montgomery arithmetic and primality
+    a->digits[0] |= 1;
+    b->digits[0] |= 1;
+    bigint_to_mpz(za, a);
+    bigint_to_mpz(zb, b);
+
+    k = 1 + rand() % (32 * a->size);
+    r = bigint_modinv_pow2(a, k);
+    mpz_set_ui(zm, 0);
+    mpz_setbit(zm, k);
+    mpz_invert(zr, za, zm);
+    failures += fuzz_check("modinv_pow2", r, zr, a, b);
+    bigint_free(r);
+
+    if (b->size <= 64 && bigint_cmp_small(b, 1) > 0) {
+      BigInt *e = fuzz_operand(1 + rand() % 4);
+      mpz_t ze;
+      mpz_init(ze);
+      bigint_to_mpz(ze, e);
+      mpz_powm(zr, za, ze, zb);
+
+      r = montgomery_powm(a, e, b);
+      failures += fuzz_check("montgomery_powm", r, zr, a, b);
+      bigint_free(r);
+      r = montgomery_powm_ct(a, e, b);
+      failures += fuzz_check("montgomery_powm_ct", r, zr, a, b);
+      bigint_free(r);
+
+      bigint_mont_ctx *mont = bigint_mont_init(b);
+      BigInt *aM = bigint_mont_to(a, mont);
+      r = bigint_mont_from(aM, mont);
+      mpz_mod(zr, za, zb);
+      failures += fuzz_check("mont_to/mont_from", r, zr, a, b);
+      bigint_free(aM);
+      bigint_free(r);
+
+      // Batch of bases and exponents of various lengths, 5 is not a
+      // multiple of the number of lanes
+      enum { BATCH = 5 };
+      BigInt *bases[BATCH], *exps[BATCH], *res[BATCH];
+      for (int i = 0; i < BATCH; i++) {
+        int words = 1 + rand() % (b->size + 1);
+        bases[i] = i ? fuzz_operand(words) : bigint_copy(a);
+        exps[i] = i ? fuzz_operand(1 + rand() % 4) : bigint_copy(e);
+      }
+      for (int ct = 0; ct < 2; ct++) {
+        if (ct)
+          bigint_mont_powm_batch_ct(res, bases, exps, BATCH, mont);
+        else
+          bigint_mont_powm_batch(res, bases, exps, BATCH, mont);
+        for (int i = 0; i < BATCH; i++) {
+          mpz_t zx;
+          mpz_inits(zx, NULL);
+          bigint_to_mpz(zx, bases[i]);
+          bigint_to_mpz(ze, exps[i]);
+          mpz_powm(zr, zx, ze, zb);
+          failures += fuzz_check(ct ? "mont_powm_batch_ct" : "mont_powm_batch",
+                                 res[i], zr, bases[i], b);
+          bigint_free(res[i]);
+          mpz_clear(zx);
+        }
+      }
+      for (int i = 0; i < BATCH; i++) {
+        bigint_free(bases[i]);
+        bigint_free(exps[i]);
+      }
+      bigint_mont_free(mont);
+
+      bigint_free(e);
+      mpz_clear(ze);
+    }
+
+    if (b->size <= 16 && bigint_cmp_small(b, 3) > 0) {
+      // A prime near b and b itself (most likely composite)
+      mpz_nextprime(zr, zb);
+      BigInt *p = bigint_from_mpz(zr);
+      bool expected = mpz_probab_prime_p(zb, 25) > 0;
+      if (!is_probable_prime(p, 25) || is_probable_prime(b, 25) != expected) {
+        printf("Échec is_probable_prime\nb = ");
+        bigint_print(b);
+        failures++;
+      }
+      bigint_free(p);
+    }
+
+    // Signed operations, random signs
+    a->negative = rand() % 2 && !bigint_is_zero(a);
+    b->negative = rand() % 2 && !bigint_is_zero(b);
+    bigint_to_mpz(za, a);
+    bigint_to_mpz(zb, b);
+
+    r = bigint_sadd(a, b);
+    mpz_add(zr, za, zb);
+    failures += fuzz_check("sadd", r, zr, a, b);
+    bigint_free(r);
+
+    r = bigint_ssub(a, b);
+    mpz_sub(zr, za, zb);
+    failures += fuzz_check("ssub", r, zr, a, b);
+    bigint_free(r);
+
+    r = bigint_smul(a, b);
+    mpz_mul(zr, za, zb);
+    failures += fuzz_check("smul", r, zr, a, b);
+    bigint_free(r);
+
+    if (!bigint_is_zero(b)) {
+      bigint_sdivmod(a, b, &q, &r);
+      mpz_fdiv_qr(zq, zr, za, zb);
+      failures += fuzz_check("sdivmod (quotient)", q, zq, a, b);
+      failures += fuzz_check("sdivmod (reste)", r, zr, a, b);
+      bigint_free(q);
+      bigint_free(r);
+
+      // Centered remainder modulo |b|
+      r = bigint_smod_centered(a, b);
+      mpz_abs(zm, zb);
+      mpz_fdiv_r(zr, za, zm);
+      mpz_fdiv_q_2exp(zq, zm, 1);
+      if (mpz_cmp(zr, zq) >= 0) mpz_sub(zr, zr, zm);
+      failures += fuzz_check("smod_centered", r, zr, a, b);
+      bigint_free(r);
+    }
+
+    // Radix conversions and raw limbs, signed
+    failures += fuzz_radix(a, za);
+
+    bigint_free(a);
+    bigint_free(b);
+
+    failures += fuzz_fixed512();
+    if (it % 8 == 0) failures += fuzz_fixed8192() + fuzz_fixed_mul();
+  }
+
+  mpz_clears(za, zb, zr, zq, zm, NULL);
+  printf("%d échec(s)\n", failures);
+  return failures;
+}
+
+// Operands shared by the benchmarked operations at one size
+typedef struct {
+  int bits;
+  BigInt *a, *b, *wide, *odd, *mod, *exp, *prime;
+  mpz_t za, zb, zwide, zodd, zmod, zexp, zprime, zr, zpow2;
+  char *dec;  // Decimal string of a
+  bigint_mont_ctx *mont;  // Context of mod
+  int sink;  // Keeps results of pure functions alive
+} bench_operands;
+
+typedef void (*bench_fn)(bench_operands *);
+
+static void bench_add(bench_operands *o) { bigint_free(bigint_add(o->a, o->b)); }
+static void bench_add_gmp(bench_operands *o) { mpz_add(o->zr, o->za, o->zb); }
+static void bench_sub(bench_operands *o) { bigint_free(bigint_sub(o->a, o->b)); }
+static void bench_sub_gmp(bench_operands *o) { mpz_sub(o->zr, o->za, o->zb); }
+static void bench_mul(bench_operands *o) { bigint_free(bigint_mul(o->a, o->b)); }
+static void bench_mul_gmp(bench_operands *o) { mpz_mul(o->zr, o->za, o->zb); }
+static void bench_mod(bench_operands *o) { bigint_free(bigint_mod(o->wide, o->b)); }
+static void bench_mod_gmp(bench_operands *o) { mpz_mod(o->zr, o->zwide, o->zb); }
+
+static void bench_mul_low(bench_operands *o) {
+  bigint_free(bigint_mul_low(o->a, o->b, o->bits));
+}
+static void bench_mul_low_gmp(bench_operands *o) {
+  mpz_mul(o->zr, o->za, o->zb);
+  mpz_fdiv_r_2exp(o->zr, o->zr, o->bits);
+}
+
+static void bench_modinv_pow2(bench_operands *o) {
+  bigint_free(bigint_modinv_pow2(o->odd, o->bits));
+}
+static void bench_modinv_pow2_gmp(bench_operands *o) {
+  mpz_invert(o->zr, o->zodd, o->zpow2);
+}
+
+static void bench_powm(bench_operands *o) {
+  bigint_free(montgomery_powm(o->a, o->exp, o->mod));
+}
+static void bench_powm_gmp(bench_operands *o) {
+  mpz_powm(o->zr, o->za, o->zexp, o->zmod);
+}
+
+// Batch of BENCH_BATCH exponentiations under one modulus, against a loop
+#define BENCH_BATCH 8
+static void bench_powm_batch(bench_operands *o) {
+  BigInt *bases[BENCH_BATCH], *exps[BENCH_BATCH], *res[BENCH_BATCH];
+  for (int i = 0; i < BENCH_BATCH; i++) {
+    bases[i] = o->a;
+    exps[i] = o->exp;
+  }
+  bigint_mont_powm_batch(res, bases, exps, BENCH_BATCH, o->mont);
+  for (int i = 0; i < BENCH_BATCH; i++) bigint_free(res[i]);
+}
+static void bench_powm_loop(bench_operands *o) {
+  for (int i = 0; i < BENCH_BATCH; i++)
+    bigint_free(bigint_mont_powm(o->a, o->exp, o->mont));
+}
+static void bench_powm_loop_gmp(bench_operands *o) {
+  for (int i = 0; i < BENCH_BATCH; i++)
+    mpz_powm(o->zr, o->za, o->zexp, o->zmod);
+}
+
+static void bench_to_dec(bench_operands *o) { free(bigint_to_dec(o->a)); }
+static void bench_to_dec_gmp(bench_operands *o) {
+  free(mpz_get_str(NULL, 10, o->za));
+}
+static void bench_from_dec(bench_operands *o) {
+  bigint_free(bigint_from_dec(o->dec));
+}
+static void bench_from_dec_gmp(bench_operands *o) {
+  mpz_set_str(o->zr, o->dec, 10);
+}
+static void bench_prime(bench_operands *o) {
+  o->sink += is_probable_prime(o->prime, 10);
+}
+static void bench_prime_gmp(bench_operands *o) {
+  o->sink += mpz_probab_prime_p(o->zprime, 10);
+}
+
+// Benchmarked operations, with the largest size each one is run at
+static const struct {
+  const char *name;
+  bench_fn bigint, gmp;
+  int max_bits;
+} bench_ops[] = {
+    {"add", bench_add, bench_add_gmp, 262144},
+    {"sub", bench_sub, bench_sub_gmp, 262144},
+    {"mul", bench_mul, bench_mul_gmp, 262144},
+    {"mod", bench_mod, bench_mod_gmp, 262144},
+    {"mul_low", bench_mul_low, bench_mul_low_gmp, 262144},
+    {"modinv_pow2", bench_modinv_pow2, bench_modinv_pow2_gmp, 262144},
+    {"montgomery_powm", bench_powm, bench_powm_gmp, 4096},
+    {"mont_powm_loop8", bench_powm_loop, bench_powm_loop_gmp, 4096},
+    {"mont_powm_batch8", bench_powm_batch, bench_powm_loop_gmp, 4096},
+    {"to_dec", bench_to_dec, bench_to_dec_gmp, 262144},
+    {"from_dec", bench_from_dec, bench_from_dec_gmp, 262144},
+    {"is_probable_prime", bench_prime, bench_prime_gmp, 2048},
+};
+
+static double bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int bench_cmp_double(const void *x, const void *y) {
+  double a = *(const double *)x, b = *(const double *)y;
+  return (a > b) - (a < b);
+}
+
+// Times fn and prints one CSV line : after a warm-up, each sample times a
+// batch of reps calls so that it lasts at least BENCH_SAMPLE_NS
+#define BENCH_SAMPLE_NS 1e6
+#define BENCH_BUDGET_NS 2e8
+#define BENCH_MAX_SAMPLES 101
+static void bench_run(const char *op, const char *impl, bench_fn fn,
+                      bench_operands *o) {
+  // Warm-up, then estimate the cost of one call
+  double start = bench_now_ns();
+  int warmup = 0;
+  do {
+    fn(o);
+    warmup++;
+  } while (bench_now_ns() - start < BENCH_SAMPLE_NS && warmup < 1000);
+  start = bench_now_ns();
+  for (int i = 0; i < warmup; i++) fn(o);
+  double once = (bench_now_ns() - start) / warmup;
+
+  int reps = (once < BENCH_SAMPLE_NS) ? (int)(BENCH_SAMPLE_NS / once) : 1;
+  int samples = (int)(BENCH_BUDGET_NS / (once * reps));
+  if (samples < 5) samples = 5;
+  if (samples > BENCH_MAX_SAMPLES) samples = BENCH_MAX_SAMPLES;
+
+  double times[BENCH_MAX_SAMPLES];
+  for (int i = 0; i < samples; i++) {
+    double t0 = bench_now_ns();
+    for (int j = 0; j < reps; j++) fn(o);
+    times[i] = (bench_now_ns() - t0) / reps;
+  }
+  qsort(times, samples, sizeof(double), bench_cmp_double);
+
+  printf("%s,%s,%d,%d,%d,%.0f,%.0f,%.0f,%.0f\n", op, impl, o->bits, samples,
+         reps, times[samples / 2], times[samples / 10],
+         times[(samples * 9) / 10], times[samples - 1]);
+  fflush(stdout);
+}
+
+static void bench_operands_init(bench_operands *o, int bits) {
+  int words = bits / 32;
+  o->bits = bits;
+  o->sink = 0;
+  mpz_inits(o->za, o->zb, o->zwide, o->zodd, o->zmod, o->zexp, o->zprime,
+            o->zr, o->zpow2, NULL);
+
+  // a > b so that a - b is valid, both on bits bits
+  o->a = bigint_random(words);
+  o->b = bigint_random(words);
+  o->a->size = o->b->size = words;
+  o->a->digits[words - 1] |= 0x80000000;
+  o->b->digits[words - 1] &= 0x7FFFFFFF;
+  o->b->digits[words - 1] |= 0x40000000;
+  o->wide = bigint_random(2 * words);
+  o->odd = bigint_copy(o->a);
+  o->odd->digits[0] |= 1;
+  o->mod = bigint_copy(o->b);
+  o->mod->digits[0] |= 1;
+  o->exp = bigint_random(words);
+  o->mont = bigint_mont_init(o->mod);
+
+  bigint_to_mpz(o->za, o->a);
+  bigint_to_mpz(o->zb, o->b);
+  bigint_to_mpz(o->zwide, o->wide);
+  bigint_to_mpz(o->zodd, o->odd);
+  bigint_to_mpz(o->zmod, o->mod);
+  bigint_to_mpz(o->zexp, o->exp);
+  mpz_setbit(o->zpow2, bits);
+  o->dec = mpz_get_str(NULL, 10, o->za);
+
+  o->prime = NULL;
+  if (bits <= 2048) {
+    mpz_nextprime(o->zprime, o->za);
+    o->prime = bigint_from_mpz(o->zprime);
+  }
+}
+
+static void bench_operands_clear(bench_operands *o) {
+  bigint_free(o->a);
+  bigint_free(o->b);
+  bigint_free(o->wide);
+  bigint_free(o->odd);
+  bigint_free(o->mod);
+  bigint_free(o->exp);
+  bigint_mont_free(o->mont);
+  if (o->prime) bigint_free(o->prime);
+  free(o->dec);
+  mpz_clears(o->za, o->zb, o->zwide, o->zodd, o->zmod, o->zexp, o->zprime,
+             o->zr, o->zpow2, NULL);
+}
+
+// Fixed-width types at the DGHV sizes, same operands as the dynamic rows
+static struct {
+  bigint512 a, b, r;
+  bigint1024 w;
+  bigint512_barrett_ctx ctx;
+  bigint8192 a8, b8, r8;
+  bigint16384 w8;
+  bigint8192_barrett_ctx ctx8;
+} bench_fixed;
+
+static void bench_add_fixed512(bench_operands *o) {
+  __asm__ volatile("" ::: "memory");  // Inlined : keep it in the loop
+  o->sink += bigint512_add(&bench_fixed.r, &bench_fixed.a, &bench_fixed.b);
+}
+static void bench_mul_fixed512(bench_operands *o) {
+  (void)o;
+  bigint512_mul(&bench_fixed.w, &bench_fixed.a, &bench_fixed.b);
+}
+static void bench_mod_fixed512(bench_operands *o) {
+  bigint512_mod(&bench_fixed.r, o->wide, &bench_fixed.ctx);
+}
+static void bench_add_fixed8192(bench_operands *o) {
+  __asm__ volatile("" ::: "memory");  // Inlined : keep it in the loop
+  o->sink += bigint8192_add(&bench_fixed.r8, &bench_fixed.a8, &bench_fixed.b8);
+}
+static void bench_mul_fixed8192(bench_operands *o) {
+  (void)o;
+  bigint8192_mul(&bench_fixed.w8, &bench_fixed.a8, &bench_fixed.b8);
+}
+static void bench_mod_fixed8192(bench_operands *o) {
+  bigint8192_mod(&bench_fixed.r8, o->wide, &bench_fixed.ctx8);
+}
+
+static void bench_fixed_run(bench_operands *o) {
+  if (o->bits == 512) {
+    bigint512_from_bigint(&bench_fixed.a, o->a);
+    bigint512_from_bigint(&bench_fixed.b, o->b);
+    bigint512_barrett_init(&bench_fixed.ctx, o->b);
+    bench_run("add", "bigint-fixed", bench_add_fixed512, o);
+    bench_run("mul", "bigint-fixed", bench_mul_fixed512, o);
+    bench_run("mod", "bigint-fixed", bench_mod_fixed512, o);
+  } else if (o->bits == 8192) {
+    bigint8192_from_bigint(&bench_fixed.a8, o->a);
+    bigint8192_from_bigint(&bench_fixed.b8, o->b);
+    bigint8192_barrett_init(&bench_fixed.ctx8, o->b);
+    bench_run("add", "bigint-fixed", bench_add_fixed8192, o);
+    bench_run("mul", "bigint-fixed", bench_mul_fixed8192, o);
+    bench_run("mod", "bigint-fixed", bench_mod_fixed8192, o);
+  }
+}
+
+// Microbenchmark of every primitive against GMP from 64 to max_bits bits
+// Output is CSV, times are per call in nanoseconds
+void bigint_bench(int max_bits) {
+  char impl[32];
+  snprintf(impl, sizeof(impl), "bigint-%s", bigint_backend_name());
+  printf("operation,implementation,bits,samples,reps,median_ns,p10_ns,p90_ns,"
+         "max_ns\n");
+  int count = sizeof(bench_ops) / sizeof(bench_ops[0]);
+  for (int bits = 64; bits <= max_bits; bits *= 2) {
+    bench_operands o;
+    bench_operands_init(&o, bits);
+    for (int i = 0; i < count; i++) {
+      if (bits > bench_ops[i].max_bits) continue;
+      bench_run(bench_ops[i].name, impl, bench_ops[i].bigint, &o);
+      bench_run(bench_ops[i].name, "gmp", bench_ops[i].gmp, &o);
+    }
+    bench_fixed_run(&o);
+    bench_operands_clear(&o);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bigint_bench((argc > 2) ? atoi(argv[2]) : 262144);
+    return EXIT_SUCCESS;
+  }
+
+  if (argc > 1 && strcmp(argv[1], "fuzz") == 0) {
+    int iterations = (argc > 2) ? atoi(argv[2]) : 1000;
+    unsigned int seed =
+        (argc > 3) ? strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+    return bigint_fuzz(iterations, seed) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  char *sep = "----------------------------------------\n";
+  if (true) {
+    printf("%s", sep);
+    printf("Addition\n");
+
+    mpz_t gmp_a, gmp_b, gmp_result;
+    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
+    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
+    mpz_init(gmp_result);
+    mpz_add(gmp_result, gmp_a, gmp_b);
+    BigInt *a = bigint_from_hex("123456789012345678901234567890");
+    BigInt *b = bigint_from_hex("987654321098765432109876543210");
+    BigInt *result = bigint_add(a, b);
+
+    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
+    printf("Résultat BigInt  : ");
+    bigint_print(result);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(result);
+    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Soustraction\n");
+
+    const char *hex_a = "0000000100000000000000000000000000000000";
+    const char *hex_b = "0004FFFFFFFFFFFFFFFFFFFFFFFFFFFF";
+
+    mpz_t gmp_a, gmp_b, gmp_result;
+    mpz_init_set_str(gmp_a, hex_a, 16);
+    mpz_init_set_str(gmp_b, hex_b, 16);
+    mpz_init(gmp_result);
+    mpz_sub(gmp_result, gmp_a, gmp_b);
+    BigInt *a = bigint_from_hex(hex_a);
+    BigInt *b = bigint_from_hex(hex_b);
+    BigInt *result = bigint_sub(a, b);
+
+    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
+    printf("Résultat BigInt  : ");
+    bigint_print(result);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(result);
+    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Multiplication\n");
+
+    mpz_t gmp_a, gmp_b, gmp_result;
+    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
+    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
+    mpz_init(gmp_result);
+    mpz_mul(gmp_result, gmp_a, gmp_b);
+    BigInt *a = bigint_from_hex("123456789012345678901234567890");
+    BigInt *b = bigint_from_hex("987654321098765432109876543210");
+    BigInt *result = bigint_mul(a, b);
+
+    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
+    printf("Résultat BigInt  : ");
+    bigint_print(result);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(result);
+    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Modulo\n");
+
+    mpz_t gmp_a, gmp_b, gmp_result;
+    mpz_init_set_str(gmp_a, "123456789012345678901234567890", 16);
+    mpz_init_set_str(gmp_b, "987654321098765432109876543210", 16);
+    mpz_init(gmp_result);
+    mpz_mod(gmp_result, gmp_b, gmp_a);
+    BigInt *a = bigint_from_hex("123456789012345678901234567890");
+    BigInt *b = bigint_from_hex("987654321098765432109876543210");
+    BigInt *result = bigint_mod(b, a);
+
+    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
+    printf("Résultat BigInt  : ");
+    bigint_print(result);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(result);
+    mpz_clears(gmp_a, gmp_b, gmp_result, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Division euclidienne\n");
+
+    const char *hex_a =
+        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3";
+    const char *hex_b = "80000000FFFFFFFF00000001";
+
+    mpz_t gmp_a, gmp_b, gmp_q, gmp_r;
+    mpz_init_set_str(gmp_a, hex_a, 16);
+    mpz_init_set_str(gmp_b, hex_b, 16);
+    mpz_inits(gmp_q, gmp_r, NULL);
+    mpz_tdiv_qr(gmp_q, gmp_r, gmp_a, gmp_b);
+    BigInt *a = bigint_from_hex(hex_a);
+    BigInt *b = bigint_from_hex(hex_b);
+    BigInt *q, *r;
+    bigint_divmod(a, b, &q, &r);
+
+    gmp_printf("Quotient GMP     : 0x%Zx\n", gmp_q);
+    printf("Quotient BigInt  : ");
+    bigint_print(q);
+    gmp_printf("Reste GMP        : 0x%Zx\n", gmp_r);
+    printf("Reste BigInt     : ");
+    bigint_print(r);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(q);
+    bigint_free(r);
+    mpz_clears(gmp_a, gmp_b, gmp_q, gmp_r, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Réduction de Barrett\n");
+
+    const char *hex_a =
+        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3";
+    const char *hex_m = "F1C5A2B3C4D5E6F708192A3B4C5D6E7F";
+
+    mpz_t gmp_a, gmp_m, gmp_result;
+    mpz_init_set_str(gmp_a, hex_a, 16);
+    mpz_init_set_str(gmp_m, hex_m, 16);
+    mpz_init(gmp_result);
+    mpz_mod(gmp_result, gmp_a, gmp_m);
+    BigInt *a = bigint_from_hex(hex_a);
+    BigInt *m = bigint_from_hex(hex_m);
+    bigint_barrett_ctx *ctx = bigint_barrett_init(m);
+    BigInt *result = bigint_barrett_reduce(a, ctx);
+
+    gmp_printf("Résultat GMP     : 0x%Zx\n", gmp_result);
+    printf("Résultat BigInt  : ");
+    bigint_print(result);
+    bigint_barrett_free(ctx);
+    bigint_free(a);
+    bigint_free(m);
+    bigint_free(result);
+    mpz_clears(gmp_a, gmp_m, gmp_result, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Multiplication basse\n");
+
+    mpz_t gmp_a, gmp_b, gmp_res, gmp_mask;
+    mpz_inits(gmp_a, gmp_b, gmp_res, gmp_mask, NULL);
+
+    mpz_set_str(gmp_a, "FFFFFFFFFFFFFFFFFFFFFFFF", 16);
+    mpz_set_str(gmp_b, "12345678", 16);
+
+    mpz_mul(gmp_res, gmp_a, gmp_b);
+
+    // Mask on k_bits (simuling bigint_mul_low)
+    mpz_setbit(gmp_mask, 96);
+    mpz_sub_ui(gmp_mask, gmp_mask, 1);
+    mpz_and(gmp_res, gmp_res, gmp_mask);
+
+    char *gmp_str = mpz_get_str(NULL, 16, gmp_res);
+
+    BigInt *a = bigint_from_hex("FFFFFFFFFFFFFFFFFFFFFFFF");
+    BigInt *b = bigint_from_hex("12345678");
+    BigInt *my_res = bigint_mul_low(a, b, 96);
+
+    bigint_print(a);
+    bigint_print(b);
+    printf("Résultat GMP      : 0x%s\n", gmp_str);
+    printf("Résultat BigInt   : ");
+    bigint_print(my_res);
+
+    free(gmp_str);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(my_res);
+    mpz_clears(gmp_a, gmp_b, gmp_res, gmp_mask, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Inverse modulaire\n");
+
+    const char *m = "FFFAFFFFFFFFFFFFFFFFFFFFFFFFFFFF";
+    const char *m_inv = "4ffffffffffffffffffffffffffff";
+    int k = 128;
+
+    test_modinv_with_gmp(m, k);
+    test_modinv_with_gmp(m_inv, k);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Shift à droite (division par 2)\n");
+
+    int s = 24;
+    BigInt *a = bigint_from_hex("123456789012345678901234567890");
+    BigInt *result = bigint_div_pow2(a, s);
+    bigint_print(a);
+    printf(">> %i  : \n", s);
+    bigint_print(result);
+    bigint_free(a);
+    bigint_free(result);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Réduction de Montgomery\n");
+    test_montgomery_reduce_once(
+        "123456789ABCDEF0123456789ABCDEF0",  // T
+        "FFFAFFFFFFFFFFFFFFFFFFFFFFFFFFFF",  // m
+        "FFFB0000000000000000000000000001",  // m_inv = –m⁻¹ mod 2^128
+        128);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Négation\n");
+    BigInt *a = bigint_from_hex("123456789ABCDEF0");
+    printf("Avant négation : ");
+    bigint_print(a);
+    bigint_negate(a);
+    printf("Après négation : ");
+    bigint_print(a);
+    bigint_free(a);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Longueur en bits\n");
+    BigInt *a = bigint_from_hex("523456789ABCDEF0");
+    bigint_print(a);
+    printf("Nombre de bits : %d\n", bigint_bit_length(a));
+    bigint_free(a);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Multiplication de Montgomery\n");
+    test_montgomery_mul_once("0000004A3414C4C0", "000000010000000000000000",
+                             "00000080C970E2C9", 64);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Génération de nombres aléatoires\n");
+    int num_blocks = 4;
+    BigInt *num = bigint_random(num_blocks);
+    printf("Nombre aléatoire : ");
+    bigint_print(num);
+    bigint_free(num);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Exponentiation modulaire\n");
+    test_montgomery_powm("0000005B3164DB0C", "3", "00000080C970E2C9", 128);
+    test_montgomery_powm(
+        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3",
+        "7BAE0D51C9B003D4F1F47D2F8650B991CA0B4D71E93B3280EFA4DDC0C4020593E5",
+        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763",
+        264);
+    printf("\n");
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Contexte de Montgomery\n");
+
+    const char *hex_n =
+        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763";
+    const char *hex_a = "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598";
+    const char *hex_e[] = {"10001", "7BAE0D51C9B003D4F1F47D2F8650B991"};
+
+    BigInt *n = bigint_from_hex(hex_n);
+    BigInt *a = bigint_from_hex(hex_a);
+    bigint_mont_ctx *ctx = bigint_mont_init(n);
+
+    mpz_t gN, gA, gE, gR;
+    mpz_inits(gN, gA, gE, gR, NULL);
+    mpz_set_str(gN, hex_n, 16);
+    mpz_set_str(gA, hex_a, 16);
+
+    for (int i = 0; i < 2; i++) {
+      BigInt *e = bigint_from_hex(hex_e[i]);
+      BigInt *r = bigint_mont_powm(a, e, ctx);
+      mpz_set_str(gE, hex_e[i], 16);
+      mpz_powm(gR, gA, gE, gN);
+      gmp_printf("Résultat GMP     : 0x%Zx\n", gR);
+      printf("Résultat BigInt  : ");
+      bigint_print(r);
+      bigint_free(e);
+      bigint_free(r);
+    }
+
+    BigInt *aM = bigint_mont_to(a, ctx);
+    BigInt *back = bigint_mont_from(aM, ctx);
+    printf("Aller-retour     : ");
+    bigint_print(back);
+
+    bigint_free(aM);
+    bigint_free(back);
+    bigint_free(n);
+    bigint_free(a);
+    bigint_mont_free(ctx);
+    mpz_clears(gN, gA, gE, gR, NULL);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Test de primalité\n");
+
+    char *n_hex =
+        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3"
+        "7BAE0D51C9B003D4F1F47D2F8650B991CA0B4D71E93B3280EFA4DDC0C4020593E5"
+        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763"
+        "270DC9EE539493A9793370DADA6409A68ED77E0E5930477C66DE26FCA9";
+    test_primality_with_gmp(n_hex, 10);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Vitesse du modulo avec petits modulos\n");
+
+    char *n_hex =
+        "90CBE39B245DB9B5C4B637BC43576D9B01131DE08CDBE598D4EA8EA6328E28D2B3"
+        "7BAE0D51C9B003D4F1F47D2F8650B991CA0B4D71E93B3280EFA4DDC0C4020593E5"
+        "EC8F3491BD0D5322A5CC7030CA2A41899BA1D002396DF09D23D650A6951D3AC763"
+        "270DC9EE539493A9793370DADA6409A68ED77E0E5930477C66DE26FCA9";
+    BigInt *three = bigint_from_hex("3");
+    BigInt *five = bigint_from_hex("5");
+    BigInt *seven = bigint_from_hex("7");
+    BigInt *eleven = bigint_from_hex("11");
+    BigInt *thirteen = bigint_from_hex("13");
+    BigInt *a = bigint_from_hex(n_hex);
+
+    BigInt *result1 = bigint_mod(a, three);
+    printf("Résultat 1 : ");
+    bigint_print(result1);
+    BigInt *result2 = bigint_mod(a, five);
+    printf("Résultat 2 : ");
+    bigint_print(result2);
+    BigInt *result3 = bigint_mod(a, seven);
+    printf("Résultat 3 : ");
+    bigint_print(result3);
+    BigInt *result4 = bigint_mod(a, eleven);
+    printf("Résultat 4 : ");
+    bigint_print(result4);
+    BigInt *result5 = bigint_mod(a, thirteen);
+    printf("Résultat 5 : ");
+    bigint_print(result5);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Génération de nombres premiers\n");
+    int bits = 1024;
+    int iterations = 10;
+    BigInt *prime = bigint_generate_prime(bits, iterations);
+    printf("Nombre premier généré : ");
+    bigint_print(prime);
+
+    mpz_t gmp_p;
+    mpz_init(gmp_p);
+    mpz_import(gmp_p, prime->size, -1, sizeof(uint32_t), 0, 0, prime->digits);
+    printf("Taille : %zu bits\n", mpz_sizeinbase(gmp_p, 2));
+    printf("Résultat GMP : %s\n",
+           mpz_probab_prime_p(gmp_p, iterations) ? "Premier" : "Non premier");
+    mpz_clear(gmp_p);
+    bigint_free(prime);
+  }
+
+  if (true) {
+    printf("%s", sep);
+    printf("Chiffrement DGHV (entiers signés)\n");
+
+    // c = p * q + 2r + m with a signed noise r, m = (c mod p centré) mod 2
+    BigInt *p = bigint_generate_prime(512, 25);
+    BigInt *q = bigint_random((8192 - 512) / 32);
+    mpz_t gmp_p, gmp_c, gmp_d;
+    mpz_inits(gmp_p, gmp_c, gmp_d, NULL);
+    bigint_to_mpz(gmp_p, p);
+
+    for (int m = 0; m <= 1; m++) {
+      int noise = (rand() % (1 << 16)) * (rand() % 2 ? -1 : 1);
+      BigInt *r = bigint_from_int(2 * noise + m);
+      BigInt *pq = bigint_smul(p, q);
+      BigInt *c = bigint_sadd(pq, r);
+      BigInt *d = bigint_smod_centered(c, p);
+      printf("Message : %d, bruit : %d, reste centré : %s%u\n", m, noise,
+             d->negative ? "-" : "", d->digits[0]);
+      printf("Déchiffré BigInt : %u\n", bigint_mod_small(d, 2));
+
+      bigint_to_mpz(gmp_c, c);
+      mpz_mod(gmp_d, gmp_c, gmp_p);
+      mpz_t half;
+      mpz_init(half);
+      mpz_fdiv_q_ui(half, gmp_p, 2);
+      if (mpz_cmp(gmp_d, half) >= 0) mpz_sub(gmp_d, gmp_d, gmp_p);
+      printf("Résultat GMP : %lu\n", mpz_fdiv_ui(gmp_d, 2));
+      mpz_clear(half);
+
+      bigint_free(r);
+      bigint_free(pq);
+      bigint_free(c);
+      bigint_free(d);
+    }
+
+    mpz_clears(gmp_p, gmp_c, gmp_d, NULL);
+    bigint_free(p);
+    bigint_free(q);
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+import hashlib
+import os
+import sys
+import tempfile
+from collections import OrderedDict
+
+import circuit
+
+# Ciphertexts computed by the server, content-addressed : the key of an input
+# is a hash of its value, the key of a gate a hash of its op and of the keys
+# of its arguments. Equal subexpressions over equal ciphertexts get the same
+# key whatever the circuit or the request, so they are computed once.
+#
+# Values are written to a directory, one file per key, which outlives the
+# process ; those read are kept in memory up to a size in bytes (least
+# recently used dropped first), as the tasks of one run share many keys.
+# Products, NOTs and constants are stored : an addition costs less than the
+# lookup of its value. A constant is a fresh encryption under the public key,
+# so the directory has one subdirectory per public key.
+
+STORED = ("const", "not", "and")
+
+
+# Name of the subdirectory of a public key file, a hash of its content
+def fingerprint(filename):
+    h = hashlib.sha256()
+    with open(filename, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            h.update(block)
+    return h.hexdigest()[:16]
+
+
+def value_key(c):
+    c = int(c)
+    data = c.to_bytes((c.bit_length() + 8) // 8, "little", signed=True)
+    return hashlib.sha256(b"v" + data).hexdigest()
+
+
+# Keys of every gate of a circuit for the given input values
+def gate_keys(circ, inputs):
+    keys = []
+    remaining = iter(inputs)
+    for op, args in circ.gates:
+        if op == "input":
+            keys.append(value_key(next(remaining)))
+            continue
+        if op == "const":
+            parts = [str(args[0])]
+        else:
+            parts = [keys[a] for a in args]
+            if op in ("xor", "and"):
+                parts.sort()  # Commutative
+        keys.append(hashlib.sha256(" ".join([op] + parts).encode()).hexdigest())
+    return keys
+
+
+class Cache:
+    def __init__(self, directory, limit=1 << 30, key_id=None):
+        self.directory = os.path.join(directory, key_id) if key_id else directory
+        self.limit = limit
+        self.size = 0
+        self.memory = OrderedDict()
+        self.hits = 0
+        os.makedirs(self.directory, exist_ok=True)
+
+    def path(self, key):
+        return os.path.join(self.directory, key[:2], key)
+
+    def get(self, key):
+        if key in self.memory:
+            self.memory.move_to_end(key)
+            self.hits += 1
+            return self.memory[key]
+        if os.path.exists(self.path(key)):
+            with open(self.path(key), "rb") as f:
+                value = int.from_bytes(f.read(), "little", signed=True)
+            self.remember(key, value)
+            self.hits += 1
+            return value
+        return None
+
+    # Written only : a value just computed is not looked up again in this run.
+    # Safe from the workers, which share the directory
+    def put(self, key, value):
+        if not os.path.exists(self.path(key)):
+            os.makedirs(os.path.dirname(self.path(key)), exist_ok=True)
+            # Written aside then renamed : readers never see a partial file
+            temporary = f"{self.path(key)}.{os.getpid()}"
+            with open(temporary, "wb") as f:
+                f.write(value.to_bytes((value.bit_length() + 8) // 8, "little", signed=True))
+            os.replace(temporary, self.path(key))
+
+    def remember(self, key, value):
+        size = value.bit_length() // 8 + 1
+        if size > self.limit:
+            return
+        if key in self.memory:
+            self.size -= self.memory.pop(key).bit_length() // 8 + 1
+        self.memory[key] = value
+        self.size += size
+        while self.size > self.limit:
+            _, old = self.memory.popitem(last=False)
+            self.size -= old.bit_length() // 8 + 1
+
+    # Values of the gates found in the cache, looked up from the outputs :
+    # the gates below a value found are not needed, nor looked up
+    def lookup(self, circ, keys):
+        outputs = {g for _, g in circ.outputs}
+        known, seen = {}, set()
+        stack = list(outputs)
+        while stack:
+            g = stack.pop()
+            op, args = circ.gates[g]
+            if g in seen or op == "input":
+                continue
+            seen.add(g)
+            value = self.get(keys[g]) if op in STORED or g in outputs else None
+            if value is not None:
+                known[g] = value
+            elif op != "const":
+                stack.extend(args)
+        return known
+
+    # Keys of the gates to store once computed, those not found
+    def missing(self, circ, keys, known):
+        outputs = {g for _, g in circ.outputs}
+        live = circuit.needed(circ, known)
+        return {g: keys[g] for g, (op, _) in enumerate(circ.gates)
+                if live[g] and g not in known and op != "input" and (op in STORED or g in outputs)}
+
+    # Function to pass as the record argument of the evaluators
+    def recorder(self, missing):
+        def record(g, value):
+            if g in missing:
+                self.put(missing[g], value)
+        return record
+
+
+# Values stored under one public key are not found under another
+def check():
+    b = circuit.Builder()
+    b.circuit.outputs = [("r", b.and_(b.input("x"), b.input("y"))), ("z", b.const(1))]
+    c = b.circuit
+    keys = gate_keys(c, [12345, 678])
+    with tempfile.TemporaryDirectory() as directory:
+        first = Cache(directory, key_id="a")
+        record = first.recorder(first.missing(c, keys, {}))
+        for g in range(len(c.gates)):
+            record(g, 7)
+        same, other = Cache(directory, key_id="a"), Cache(directory, key_id="b")
+        return bool(same.lookup(c, keys)) and not other.lookup(c, keys)
+
+
+if __name__ == "__main__":
+    if not check():
+        print("Erreur : le cache mélange les clés publiques")
+        sys.exit(1)
+    print("Cache vérifié")
@@ -0,0 +1,554 @@
+import heapq
+import itertools
+import sys
+from concurrent.futures import FIRST_COMPLETED, wait
+
+# Boolean circuits over encrypted bits : a text format, an optimiser and an
+# evaluator parametrised by the gate implementations.
+#
+# Format, one statement per line, '#' starts a comment :
+#   inputs a b c d
+#   t = and a b          # and, xor, or take two arguments or more
+#   u = not t
+#   z = const 1
+#   outputs t u
+# 'or' is expanded to a + b + a*b, like or_h in server.py.
+
+OPS = ("input", "const", "not", "xor", "and")
+
+
+class Circuit:
+    def __init__(self):
+        self.gates = []    # (op, args), args are indices of earlier gates
+        self.inputs = []   # Names of the inputs, gates 0 .. len - 1
+        self.outputs = []  # (name, gate index)
+
+    def add(self, op, *args):
+        self.gates.append((op, args))
+        return len(self.gates) - 1
+
+    # Multiplicative depth of every gate : the noise of a DGHV ciphertext
+    # grows with the number of products it went through
+    def depths(self):
+        depth = []
+        for op, args in self.gates:
+            d = max((depth[a] for a in args if op != "const"), default=0)
+            depth.append(d + 1 if op == "and" else d)
+        return depth
+
+    def stats(self):
+        count = {op: 0 for op in OPS}
+        for op, _ in self.gates:
+            count[op] += 1
+        depth = self.depths()
+        return {"and": count["and"], "xor": count["xor"], "not": count["not"],
+                "depth": max((depth[g] for _, g in self.outputs), default=0)}
+
+
+def parse(lines, filename="<circuit>"):
+    circuit = Circuit()
+    names = {}
+
+    def error(number, message):
+        raise ValueError(f"{filename}:{number} : {message}")
+
+    def arg(number, name):
+        if name not in names:
+            error(number, f"signal inconnu '{name}'")
+        return names[name]
+
+    for number, line in enumerate(lines, 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+        if words[0] == "inputs":
+            for name in words[1:]:
+                if name in names:
+                    error(number, f"signal déjà défini '{name}'")
+                names[name] = circuit.add("input")
+                circuit.inputs.append(name)
+            continue
+        if words[0] == "outputs":
+            circuit.outputs += [(name, arg(number, name)) for name in words[1:]]
+            continue
+        if len(words) < 3 or words[1] != "=":
+            error(number, "attendu '<nom> = <porte> <arguments>'")
+
+        name, op, params = words[0], words[2], words[3:]
+        if name in names:
+            error(number, f"signal déjà défini '{name}'")
+        if op == "const":
+            if params not in (["0"], ["1"]):
+                error(number, "const prend 0 ou 1")
+            names[name] = circuit.add("const", int(params[0]))
+        elif op == "not":
+            if len(params) != 1:
+                error(number, "not prend un argument")
+            names[name] = circuit.add("not", arg(number, params[0]))
+        elif op in ("xor", "and", "or"):
+            if len(params) < 2:
+                error(number, f"{op} prend au moins deux arguments")
+            acc = arg(number, params[0])
+            for param in params[1:]:
+                x = arg(number, param)
+                if op == "or":
+                    acc = circuit.add("xor", circuit.add("xor", acc, x),
+                                      circuit.add("and", acc, x))
+                else:
+                    acc = circuit.add(op, acc, x)
+            names[name] = acc
+        else:
+            error(number, f"porte inconnue '{op}'")
+
+    if not circuit.outputs:
+        raise ValueError(f"{filename} : aucune sortie")
+    return circuit
+
+
+def load(filename):
+    with open(filename) as f:
+        return parse(f, filename)
+
+
+# Builds a circuit gate by gate, folding constants and sharing gates that
+# compute the same function of the same signals (hash-consing)
+class Builder:
+    def __init__(self, fold=True):
+        self.circuit = Circuit()
+        self.fold = fold
+        self.table = {}
+        self.depth = []
+
+    def const_value(self, g):
+        op, args = self.circuit.gates[g]
+        return args[0] if op == "const" else None
+
+    def negated(self, g):
+        op, args = self.circuit.gates[g]
+        return args[0] if op == "not" else None
+
+    def emit(self, op, args):
+        if op in ("xor", "and"):
+            args = tuple(sorted(args))
+        key = (op, args)
+        if op != "input" and key in self.table:
+            return self.table[key]
+        g = self.circuit.add(op, *args)
+        d = max((self.depth[a] for a in args if op != "const"), default=0)
+        self.depth.append(d + 1 if op == "and" else d)
+        if op != "input":
+            self.table[key] = g
+        return g
+
+    def input(self, name):
+        self.circuit.inputs.append(name)
+        return self.emit("input", ())
+
+    def const(self, value):
+        return self.emit("const", (value,))
+
+    def not_(self, a):
+        if self.fold:
+            if self.const_value(a) is not None:
+                return self.const(1 - self.const_value(a))
+            if self.negated(a) is not None:
+                return self.negated(a)
+        return self.emit("not", (a,))
+
+    def xor(self, a, b):
+        if self.fold:
+            ca, cb = self.const_value(a), self.const_value(b)
+            if ca is not None and cb is not None:
+                return self.const(ca ^ cb)
+            if ca is not None or cb is not None:
+                c, x = (ca, b) if ca is not None else (cb, a)
+                return self.not_(x) if c else x
+            if a == b:
+                return self.const(0)
+            # NOTs move to the output, where they cancel or merge
+            na, nb = self.negated(a), self.negated(b)
+            if na is not None or nb is not None:
+                x = na if na is not None else a
+                y = nb if nb is not None else b
+                inner = self.xor(x, y)
+                return inner if (na is None) == (nb is None) else self.not_(inner)
+        return self.emit("xor", (a, b))
+
+    def and_(self, a, b):
+        if self.fold:
+            ca, cb = self.const_value(a), self.const_value(b)
+            if ca is not None and cb is not None:
+                return self.const(ca & cb)
+            if ca is not None or cb is not None:
+                c, x = (ca, b) if ca is not None else (cb, a)
+                return x if c else self.const(0)
+            if a == b:
+                return a
+            if self.negated(a) == b or self.negated(b) == a:
+                return self.const(0)
+        return self.emit("and", (a, b))
+
+    # a + b + a*b, like or_h in server.py
+    def or_(self, a, b):
+        return self.xor(self.xor(a, b), self.and_(a, b))
+
+    # Combines the leaves of an associative chain ("and", "or" or "xor") as a
+    # tree, the two shallowest first, so that the result is as shallow as
+    # possible
+    def tree(self, op, leaves):
+        if not leaves:
+            return self.const(1 if op == "and" else 0)
+        if self.fold:
+            if op in ("and", "or"):
+                leaves = list(dict.fromkeys(leaves))
+            else:
+                # x + x = 0 : only the leaves seen an odd number of times stay
+                odd = {}
+                for leaf in leaves:
+                    odd[leaf] = not odd.get(leaf, False)
+                leaves = [leaf for leaf, keep in odd.items() if keep]
+                if not leaves:
+                    return self.const(0)
+        combine = {"and": self.and_, "or": self.or_, "xor": self.xor}[op]
+        order = itertools.count()
+        heap = [(self.depth[leaf], next(order), leaf) for leaf in leaves]
+        heapq.heapify(heap)
+        while len(heap) > 1:
+            _, _, a = heapq.heappop(heap)
+            _, _, b = heapq.heappop(heap)
+            g = combine(a, b)
+            heapq.heappush(heap, (self.depth[g], next(order), g))
+        return heap[0][2]
+
+
+# Copy of a circuit with dead gates removed, constants folded, common
+# subexpressions shared and, with balance, AND and XOR chains rebuilt as
+# trees of minimal multiplicative depth
+def restructure(circuit, fold=True, balance=True):
+    gates = circuit.gates
+    outputs = {g for _, g in circuit.outputs}
+
+    # Live gates and their number of users
+    live = [False] * len(gates)
+    users = [0] * len(gates)
+    for g in outputs:
+        live[g] = True
+    for g in range(len(gates) - 1, -1, -1):
+        if live[g]:
+            for a in gates[g][1]:
+                live[a] = True
+                users[a] += 1
+
+    # A gate used once by a gate of the same associative operator is
+    # absorbed into the chain of its user
+    absorbed = [False] * len(gates)
+    if balance:
+        for g, (op, args) in enumerate(gates):
+            if live[g] and op in ("xor", "and"):
+                for a in args:
+                    if gates[a][0] == op and users[a] == 1 and a not in outputs:
+                        absorbed[a] = True
+
+    builder = Builder(fold)
+    new = [None] * len(gates)
+    for g, (op, args) in enumerate(gates):
+        if op == "input":
+            new[g] = builder.input(circuit.inputs[len(builder.circuit.inputs)])
+        elif not live[g] or absorbed[g]:
+            continue
+        elif op == "const":
+            new[g] = builder.const(args[0])
+        elif op == "not":
+            new[g] = builder.not_(new[args[0]])
+        else:
+            # Leaves of the chain rooted at g
+            leaves, stack = [], list(args)
+            while stack:
+                a = stack.pop()
+                if absorbed[a]:
+                    stack += gates[a][1]
+                else:
+                    leaves.append(new[a])
+            new[g] = builder.tree(op, leaves)
+
+    builder.circuit.outputs = [(name, new[g]) for name, g in circuit.outputs]
+    return builder.circuit
+
+
+# Truth tables of the outputs, as integers whose bit m is the output for the
+# inputs given by the bits of m
+def truth_tables(circuit):
+    n = len(circuit.inputs)
+    mask = (1 << (1 << n)) - 1
+    patterns = []
+    for i in range(n):
+        pattern = 0
+        for m in range(1 << n):
+            if (m >> i) & 1:
+                pattern |= 1 << m
+        patterns.append(pattern)
+    gates = {
+        "const": lambda v: mask if v else 0,
+        "not": lambda a: a ^ mask,
+        "xor": lambda a, b: a ^ b,
+        "and": lambda a, b: a & b,
+    }
+    return evaluate(circuit, patterns, gates)
+
+
+# Algebraic normal form : the XOR of the products of inputs (sets of input
+# indices) that make up a truth table, by the Möbius transform
+def anf(table, n):
+    f = [(table >> m) & 1 for m in range(1 << n)]
+    for i in range(n):
+        for m in range(1 << n):
+            if (m >> i) & 1:
+                f[m] ^= f[m ^ (1 << i)]
+    return [tuple(i for i in range(n) if (m >> i) & 1)
+            for m in range(1 << n) if f[m]]
+
+
+# Circuit of depth ceil(log2(degree)) computing the outputs as XORs of
+# products, the products sharing the subproducts already built or the pairs
+# of inputs that occur most often
+ANF_MAX_INPUTS = 8
+
+
+def synthesise_anf(circuit):
+    n = len(circuit.inputs)
+    builder = Builder()
+    inputs = [builder.input(name) for name in circuit.inputs]
+    forms = [anf(table, n) for table in truth_tables(circuit)]
+
+    monomials = {m for form in forms for m in form if len(m) >= 2}
+    pairs = {}
+    for m in monomials:
+        for pair in itertools.combinations(m, 2):
+            pairs[pair] = pairs.get(pair, 0) + 1
+
+    def levels(k):
+        return (k - 1).bit_length()
+
+    built = {}
+
+    def product(m):
+        if len(m) == 1:
+            return inputs[m[0]]
+        if m in built:
+            return built[m]
+        target = levels(len(m))
+        split = None
+        for t in sorted(built, key=len, reverse=True):
+            if len(t) < len(m) and set(t) <= set(m) \
+                    and builder.depth[built[t]] < target \
+                    and levels(len(m) - len(t)) < target:
+                split = t
+                break
+        if split is None and len(m) > 2 and levels(len(m) - 2) < target:
+            split = max(itertools.combinations(m, 2), key=lambda p: pairs[p])
+        if split is None:
+            split = m[:(len(m) + 1) // 2]
+        rest = tuple(i for i in m if i not in split)
+        built[m] = builder.and_(product(split), product(rest))
+        return built[m]
+
+    outputs = []
+    for (name, _), form in zip(circuit.outputs, forms):
+        terms = [product(m) if m else builder.const(1)
+                 for m in sorted(form, key=len)]
+        outputs.append((name, builder.tree("xor", terms)))
+    builder.circuit.outputs = outputs
+    return builder.circuit
+
+
+def cost(circuit):
+    s = circuit.stats()
+    return (s["depth"], s["and"], s["xor"] + s["not"])
+
+
+# Optimised copy of a circuit : restructured and, for few inputs, rebuilt
+# from its algebraic normal form when that is shallower or smaller.
+# fold=False keeps x * x and x + x, whose only effect is on the noise.
+def optimise(circuit, fold=True, balance=True):
+    best = restructure(circuit, fold, balance)
+    if fold and len(circuit.inputs) <= ANF_MAX_INPUTS:
+        candidate = synthesise_anf(circuit)
+        if cost(candidate) < cost(best):
+            best = candidate
+    return best
+
+
+# Gates grouped by multiplicative level : level d holds the products of
+# depth d, then the additions and NOTs of depth d, in topological order
+def schedule(circuit):
+    depth = circuit.depths()
+    levels = [[] for _ in range(max(depth, default=0) + 1)]
+    for g, (op, _) in enumerate(circuit.gates):
+        if op == "and":
+            levels[depth[g]].append(g)
+    for g, (op, _) in enumerate(circuit.gates):
+        if op != "and":
+            levels[depth[g]].append(g)
+    return levels
+
+
+# Multiplicative depth of each output, by name
+def output_depths(circuit):
+    depth = circuit.depths()
+    return [(name, depth[g]) for name, g in circuit.outputs]
+
+
+# Gates needed for the outputs when the values of the known gates are given
+def needed(circuit, known=()):
+    live = [False] * len(circuit.gates)
+    for _, g in circuit.outputs:
+        live[g] = True
+    for g in range(len(circuit.gates) - 1, -1, -1):
+        op, args = circuit.gates[g]
+        if live[g] and g not in known and op != "const":
+            for a in args:
+                live[a] = True
+    return live
+
+
+# Evaluates a circuit on a list of input values, level by level, dropping
+# each ciphertext after the last gate that reads it. gates maps "xor", "and" and "not"
+# to functions of the values and "const" to a function of 0 or 1.
+# known maps gates to values computed earlier, the gates only they need are
+# skipped. record(g, value), if given, is called as each gate is computed.
+def evaluate(circuit, inputs, gates, known=None, record=None):
+    if len(inputs) != len(circuit.inputs):
+        raise ValueError(f"{len(circuit.inputs)} entrées attendues, {len(inputs)} reçues")
+    known = known or {}
+    values = [None] * len(circuit.gates)
+    live = needed(circuit, known)
+    order = [g for level in schedule(circuit) for g in level if live[g] and g not in known]
+    last_use = {}
+    for g in order:
+        op, args = circuit.gates[g]
+        if op != "const":
+            for a in args:
+                last_use[a] = g
+    outputs = {g for _, g in circuit.outputs}
+
+    remaining = iter(inputs)
+    for g, (op, _) in enumerate(circuit.gates):
+        if op == "input":
+            values[g] = next(remaining)
+    for g, value in known.items():
+        values[g] = value
+    for g in order:
+        op, args = circuit.gates[g]
+        if op == "const":
+            values[g] = gates["const"](args[0])
+        elif op != "input":
+            values[g] = gates[op](*(values[a] for a in args))
+            for a in args:
+                if last_use[a] == g and a not in outputs:
+                    values[a] = None
+        if record is not None and op != "input":
+            record(g, values[g])
+    return [values[g] for _, g in circuit.outputs]
+
+
+# Evaluates a circuit with its gates spread over an executor : a gate is
+# submitted as soon as its arguments are known, so that independent gates
+# run concurrently. apply(op, *values) computes one gate and must be
+# picklable for a process pool. Only the ops of remote are submitted, the
+# others cost less than moving their arguments and run here. known and record
+# as for evaluate ; a ciphertext is dropped once its last reader completes.
+def evaluate_dag(circuit, inputs, apply, executor, remote=("and",), known=None, record=None):
+    if len(inputs) != len(circuit.inputs):
+        raise ValueError(f"{len(circuit.inputs)} entrées attendues, {len(inputs)} reçues")
+    known = known or {}
+    gates = circuit.gates
+    live = needed(circuit, known)
+    users = [[] for _ in gates]
+    missing = [len(args) if op != "const" else 0 for op, args in gates]
+    for g, (op, args) in enumerate(gates):
+        if live[g] and g not in known and op != "const":
+            for a in args:
+                users[a].append(g)
+    readers = [len(u) for u in users]
+    outputs = {g for _, g in circuit.outputs}
+
+    values = [None] * len(gates)
+    ready, pending = [], {}
+
+    def done(g, value):
+        values[g] = value
+        op, args = gates[g]
+        if record is not None and op != "input":
+            record(g, value)
+        if op not in ("input", "const"):
+            for a in args:
+                readers[a] -= 1
+                if readers[a] == 0 and a not in outputs:
+                    values[a] = None
+        for u in users[g]:
+            missing[u] -= 1
+            if missing[u] == 0:
+                ready.append(u)
+
+    remaining = iter(inputs)
+    for g, (op, _) in enumerate(gates):
+        if op == "input":
+            done(g, next(remaining))
+        elif g in known:
+            values[g] = known[g]
+            for u in users[g]:
+                missing[u] -= 1
+                if missing[u] == 0:
+                    ready.append(u)
+        elif op == "const" and live[g]:
+            ready.append(g)
+
+    while ready or pending:
+        while ready:
+            g = ready.pop()
+            op, args = gates[g]
+            if op == "const":
+                done(g, apply("const", args[0]))
+            elif op in remote:
+                pending[executor.submit(apply, op, *(values[a] for a in args))] = g
+            else:
+                done(g, apply(op, *(values[a] for a in args)))
+        if pending:
+            finished, _ = wait(pending, return_when=FIRST_COMPLETED)
+            for future in finished:
+                done(pending.pop(future), future.result())
+    return [values[g] for _, g in circuit.outputs]
+
+
+PLAIN_GATES = {
+    "const": lambda v: v,
+    "not": lambda a: a ^ 1,
+    "xor": lambda a, b: a ^ b,
+    "and": lambda a, b: a & b,
+}
+
+
+# True if both circuits agree on every input, tried exhaustively
+def equivalent(a, b):
+    n = len(a.inputs)
+    for bits in itertools.product((0, 1), repeat=n):
+        if evaluate(a, list(bits), PLAIN_GATES) != evaluate(b, list(bits), PLAIN_GATES):
+            return False
+    return True
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("Usage: python3 circuit.py <circuit.circ>")
+        sys.exit(1)
+    source = load(sys.argv[1])
+    optimised = optimise(source)
+    for label, c in (("source", source), ("optimisé", optimised)):
+        s = c.stats()
+        print(f"{label} : {s['and']} and, {s['xor']} xor, {s['not']} not, profondeur {s['depth']}")
+        print("  " + ", ".join(f"{name} : {d}" for name, d in output_depths(c)))
+    if len(source.inputs) <= 16:
+        if not equivalent(source, optimised):
+            print("Erreur : le circuit optimisé n'est pas équivalent")
+            sys.exit(1)
+        print("Équivalence vérifiée sur toutes les entrées")
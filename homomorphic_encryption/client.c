@@ -6,6 +6,11 @@
 #include <sys/random.h>
 #include <time.h>
 
+#ifdef CLIENT_BIGINT
+#include "bigInt.h"
+#include "bigIntFixed.h"
+#endif
+
 #define ETA 512           // η : taille en bits de la clé secrète p
 #define RHO 16             // ρ : taille en bits du bruit r
 #define GAMMA 8192         // γ : taille en bits du bruit q
@@ -26,6 +31,167 @@ void init_rand() {
   gmp_randseed_ui(state, seed);
 }
 
+#ifdef CLIENT_BIGINT
+// Key generation, encryption and decryption on the bigInt library. GMP still
+// handles decimal I/O, JSON exports and the bootstrapping hints
+int native = 1;
+
+// 2^γ / p, bound of q
+BigInt *native_max_q(const BigInt *p, unsigned int gamma) {
+  BigInt *max_q, *rem;
+  BigInt *pow = bigint_init(1);
+  bigint_shift_left_inplace(pow, gamma);
+  bigint_divmod(pow, p, &max_q, &rem);
+  bigint_free(pow);
+  bigint_free(rem);
+  return max_q;
+}
+
+// r in ]-2^ρ, 2^ρ[
+BigInt *native_generate_r(unsigned int rho) {
+  BigInt *bound = bigint_init(1);
+  bigint_shift_left_inplace(bound, rho);
+  BigInt *r = bigint_random_below(bound);
+  if (rand() % 2 == 1) bigint_neg(r);  // randomly negate
+  bigint_free(bound);
+  return r;
+}
+
+// p * q + 2r + m
+BigInt *native_encrypt(const BigInt *p, int m) {
+  BigInt *max_q = native_max_q(p, GAMMA);
+  BigInt *q = bigint_random_below(max_q);  // q in [0, 2^γ / p[
+  BigInt *r = native_generate_r(RHOP);
+  bigint_shift_left_inplace(r, 1);
+  BigInt *x = bigint_mul(p, q);
+  BigInt *c = bigint_sadd(x, r);
+  if (m != 0) {
+    BigInt *tmp = c;
+    BigInt *one = bigint_init(1);
+    c = bigint_sadd(tmp, one);
+    bigint_free(one);
+    bigint_free(tmp);
+  }
+  bigint_free(max_q);
+  bigint_free(q);
+  bigint_free(r);
+  bigint_free(x);
+  return c;
+}
+
+BigInt *native_encrypt_public(BigInt **pk, int m) {
+  BigInt *sum = bigint_init(0);
+
+  // Random subset S incl {1, ..., TAU}
+  for (int i = 1; i <= TAU; i++) {
+    if (rand() % 2 == 0) continue;
+    if (!sum->negative && !pk[i]->negative) {
+      bigint_add_inplace(sum, pk[i]);
+    } else {
+      BigInt *tmp = sum;
+      sum = bigint_sadd(tmp, pk[i]);
+      bigint_free(tmp);
+    }
+  }
+
+  BigInt *r = native_generate_r(RHOP);
+  BigInt *noise = bigint_from_int(m != 0);
+  bigint_shift_left_inplace(r, 1);
+  bigint_shift_left_inplace(sum, 1);
+  BigInt *tmp = bigint_sadd(sum, r);
+  BigInt *c = bigint_sadd(tmp, noise);
+  BigInt *res = bigint_smod(c, pk[0]);
+
+  bigint_free(sum);
+  bigint_free(r);
+  bigint_free(noise);
+  bigint_free(tmp);
+  bigint_free(c);
+  return res;
+}
+
+// (c mod p) centered in [-p/2, p/2[, then mod 2
+// With p on ETA = 512 bits the reduction runs on the fixed-width type
+int native_decrypt(const BigInt *c, const BigInt *p) {
+  static bigint512_barrett_ctx ctx;
+  static bigint512 half_p;
+  static bool ctx_ready = false;
+  bigint512 fp, r;
+  if (bigint512_from_bigint(&fp, p) && fp.words[7] != 0) {
+    if (!ctx_ready || bigint512_cmp(&fp, &ctx.m) != 0) {
+      bigint512_barrett_init(&ctx, p);
+      for (int i = 0; i < 8; i++) {
+        uint64_t next = (i < 7) ? fp.words[i + 1] : 0;
+        half_p.words[i] = (fp.words[i] >> 1) | (next << 63);
+      }
+      ctx_ready = true;
+    }
+    bigint512_mod(&r, c, &ctx);
+    // Floor remainder for c < 0
+    if (c->negative && !bigint512_is_zero(&r)) bigint512_sub(&r, &fp, &r);
+    int m = r.words[0] & 1;
+    if (bigint512_cmp(&r, &half_p) >= 0) m ^= fp.words[0] & 1;  // r - p
+    return m;
+  }
+
+  BigInt *mod = bigint_smod_centered(c, p);
+  int m = bigint_mod_small(mod, 2);
+  bigint_free(mod);
+  return m;
+}
+
+// pk has TAU + 1 elements, x0 = pk[0] is the largest
+void native_generate_public_key(BigInt **pk, const BigInt *p) {
+  BigInt *max_q = native_max_q(p, GAMMA);
+  for (;;) {
+    for (int i = 0; i <= TAU; i++) {
+      BigInt *q = bigint_random_below(max_q);
+      BigInt *r = native_generate_r(RHO);
+      BigInt *x = bigint_mul(p, q);
+      bigint_shift_left_inplace(r, 1);
+      pk[i] = bigint_sadd(x, r);
+      bigint_free(q);
+      bigint_free(r);
+      bigint_free(x);
+    }
+
+    // x0 must be the largest
+    for (int i = 1; i <= TAU; i++) {
+      if (bigint_scmp(pk[i], pk[0]) > 0) {
+        BigInt *tmp = pk[i];
+        pk[i] = pk[0];
+        pk[0] = tmp;
+      }
+    }
+
+    // x0 must be odd and x0 mod p must be even
+    BigInt *rem = bigint_smod(pk[0], p);
+    bool valid = (pk[0]->digits[0] & 1) && !(rem->digits[0] & 1);
+    bigint_free(rem);
+    if (valid) break;
+    for (int i = 0; i <= TAU; i++) bigint_free(pk[i]);
+  }
+  bigint_free(max_q);
+}
+
+// The public key is converted once and reused by the following encryptions.
+// The cache is keyed on x0 = pk[0], not on the address of pk, which a new key
+// may reuse once the old one is freed.
+BigInt **native_public_key(const mpz_t *pk) {
+  static mpz_t cached_x0;
+  static BigInt **cached = NULL;
+  if (cached != NULL && mpz_cmp(cached_x0, pk[0]) == 0) return cached;
+  if (cached == NULL) {
+    cached = malloc((TAU + 1) * sizeof(BigInt *));
+    mpz_init(cached_x0);
+  } else
+    for (int i = 0; i <= TAU; i++) bigint_free(cached[i]);
+  for (int i = 0; i <= TAU; i++) cached[i] = bigint_from_mpz(pk[i]);
+  mpz_set(cached_x0, pk[0]);
+  return cached;
+}
+#endif
+
 // q in [0, 2^γ / p[
 void generate_q(mpz_t q, const mpz_t p, unsigned int gamma) {
   mpz_t max_q;
@@ -47,11 +213,34 @@ void generate_r(mpz_t r, unsigned int rho) {
 }
 
 void generate_prime(mpz_t prime) {
+#ifdef CLIENT_BIGINT
+  if (native) {
+    BigInt *p = bigint_generate_prime(ETA, 25);
+    bigint_to_mpz(prime, p);
+    bigint_free(p);
+    return;
+  }
+#endif
   mpz_urandomb(prime, state, ETA);
   mpz_nextprime(prime, prime);
 }
 
 void generate_public_key(mpz_t *pk, const mpz_t p) {
+#ifdef CLIENT_BIGINT
+  if (native) {
+    BigInt *pn = bigint_from_mpz(p);
+    BigInt **pkn = malloc((TAU + 1) * sizeof(BigInt *));
+    native_generate_public_key(pkn, pn);
+    for (int i = 0; i <= TAU; i++) {
+      mpz_init(pk[i]);
+      bigint_to_mpz(pk[i], pkn[i]);
+      bigint_free(pkn[i]);
+    }
+    free(pkn);
+    bigint_free(pn);
+    return;
+  }
+#endif
   for (int i = 0; i <= TAU; i++) {
     mpz_init(pk[i]);
     mpz_t q, r, x;
@@ -147,6 +336,16 @@ void convert_u_to_y(mpf_t *y, const mpz_t *u) {
 }
 
 void encrypt(mpz_t c, const mpz_t p, int m) {
+#ifdef CLIENT_BIGINT
+  if (native) {
+    BigInt *pn = bigint_from_mpz(p);
+    BigInt *cn = native_encrypt(pn, m);
+    bigint_to_mpz(c, cn);
+    bigint_free(pn);
+    bigint_free(cn);
+    return;
+  }
+#endif
   mpz_t q, r, tmp;
   mpz_inits(q, r, tmp, NULL);
   generate_q(q, p, GAMMA);
@@ -159,6 +358,14 @@ void encrypt(mpz_t c, const mpz_t p, int m) {
 }
 
 void encrypt_public(mpz_t c, const mpz_t *pk, const int m) {
+#ifdef CLIENT_BIGINT
+  if (native) {
+    BigInt *cn = native_encrypt_public(native_public_key(pk), m);
+    bigint_to_mpz(c, cn);
+    bigint_free(cn);
+    return;
+  }
+#endif
   mpz_t r, sum, tmp;
   mpz_inits(r, sum, tmp, NULL);
   mpz_set_ui(sum, 0);
@@ -181,6 +388,16 @@ void encrypt_public(mpz_t c, const mpz_t *pk, const int m) {
 }
 
 void decrypt(mpz_t result, const mpz_t c, const mpz_t p) {
+#ifdef CLIENT_BIGINT
+  if (native) {
+    BigInt *cn = bigint_from_mpz(c);
+    BigInt *pn = bigint_from_mpz(p);
+    mpz_set_ui(result, native_decrypt(cn, pn));
+    bigint_free(cn);
+    bigint_free(pn);
+    return;
+  }
+#endif
   mpz_t mod, half_p;
   mpz_inits(mod, half_p, NULL);
   mpz_mod(mod, c, p);
@@ -377,6 +594,69 @@ void print_title(const char *title) {
   print_sep();
 }
 
+double now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Times key generation, encryption and decryption with the backend selected,
+// prints one CSV line per operation and returns the number of wrong decryptions
+int bench_backend(const char *impl, int iterations) {
+  mpz_t p, c;
+  mpz_inits(p, c, NULL);
+  mpz_t *pk = malloc((TAU + 1) * sizeof(mpz_t));
+  mpz_t *ciphertexts = malloc(iterations * sizeof(mpz_t));
+  int *messages = malloc(iterations * sizeof(int));
+  int errors = 0;
+
+  double t0 = now_us();
+  generate_prime(p);
+  printf("generate_prime,%s,1,%.0f\n", impl, now_us() - t0);
+
+  t0 = now_us();
+  generate_public_key(pk, p);
+  printf("generate_public_key,%s,1,%.0f\n", impl, now_us() - t0);
+
+  for (int i = 0; i < iterations; i++) {
+    mpz_init(ciphertexts[i]);
+    messages[i] = rand() % 2;
+  }
+  t0 = now_us();
+  for (int i = 0; i < iterations; i++)
+    encrypt(ciphertexts[i], p, messages[i]);
+  printf("encrypt,%s,%d,%.1f\n", impl, iterations,
+         (now_us() - t0) / iterations);
+
+  t0 = now_us();
+  for (int i = 0; i < iterations; i++) {
+    decrypt(c, ciphertexts[i], p);
+    errors += mpz_cmp_ui(c, messages[i]) != 0;
+  }
+  printf("decrypt,%s,%d,%.1f\n", impl, iterations,
+         (now_us() - t0) / iterations);
+
+  // The first call also converts the public key
+  t0 = now_us();
+  for (int i = 0; i < iterations; i++)
+    encrypt_public(ciphertexts[i], pk, messages[i]);
+  printf("encrypt_public,%s,%d,%.1f\n", impl, iterations,
+         (now_us() - t0) / iterations);
+  for (int i = 0; i < iterations; i++) {
+    decrypt(c, ciphertexts[i], p);
+    errors += mpz_cmp_ui(c, messages[i]) != 0;
+  }
+  fflush(stdout);
+
+  for (int i = 0; i < iterations; i++) mpz_clear(ciphertexts[i]);
+  for (int i = 0; i <= TAU; i++) mpz_clear(pk[i]);
+  free(ciphertexts);
+  free(messages);
+  free(pk);
+  mpz_clears(p, c, NULL);
+  return errors;
+}
+
 int main(int argc, char *argv[]) {
   init_rand();
 
@@ -511,12 +791,23 @@ int main(int argc, char *argv[]) {
     }
     int m = (strncmp(argv[2], "0", 1) == 0) ? 0 : 1;
     char *clef_str = argv[3];
+#ifdef CLIENT_BIGINT
+    // Decimal I/O on BigInt, without going through GMP
+    BigInt *p = bigint_from_dec(clef_str);
+    BigInt *c = native_encrypt(p, m);
+    char *c_str = bigint_to_dec(c);
+    printf("%s\n", c_str);
+    free(c_str);
+    bigint_free(c);
+    bigint_free(p);
+#else
     mpz_t clef, res;
     mpz_inits(clef, res, NULL);
     mpz_set_str(clef, clef_str, 10);
     encrypt(res, clef, m);
     gmp_printf("%Zd\n", res);
     mpz_clears(clef, res, NULL);
+#endif
   }
 
   else if (strncmp(argv[1], "decrypt", 8) == 0) {
@@ -526,6 +817,13 @@ int main(int argc, char *argv[]) {
     }
     char *ch_str = argv[2];
     char *clef_str = argv[3];
+#ifdef CLIENT_BIGINT
+    BigInt *c = bigint_from_dec(ch_str);
+    BigInt *p = bigint_from_dec(clef_str);
+    printf("%d\n", native_decrypt(c, p));
+    bigint_free(c);
+    bigint_free(p);
+#else
     mpz_t c, clef, res;
     mpz_inits(c, clef, res, NULL);
     mpz_set_str(c, ch_str, 10);
@@ -533,10 +831,32 @@ int main(int argc, char *argv[]) {
     decrypt(res, c, clef);
     gmp_printf("%Zd\n", res);
     mpz_clears(clef, res, NULL);
+#endif
+  }
+
+  else if (strcmp(argv[1], "bench") == 0) {
+    int iterations = (argc > 2) ? atoi(argv[2]) : 100;
+    if (iterations <= 0) {
+      printf("Syntaxe : %s bench [itérations]\n", argv[0]);
+      return 1;
+    }
+    printf("operation,implementation,iterations,mean_us\n");
+    int errors = 0;
+#ifdef CLIENT_BIGINT
+    char impl[32];
+    snprintf(impl, sizeof(impl), "bigint-%s", bigint_backend_name());
+    errors += bench_backend(impl, iterations);
+    native = 0;
+#endif
+    errors += bench_backend("gmp", iterations);
+    if (errors) {
+      fprintf(stderr, "%d déchiffrements incorrects\n", errors);
+      return 1;
+    }
   }
 
   else {
-    printf("Syntaxe : %s test | key | encrypt | decrypt \n", argv[0]);
+    printf("Syntaxe : %s test | key | encrypt | decrypt | bench \n", argv[0]);
     return 1;
   }
 
@@ -0,0 +1,192 @@
+import math
+
+import circuit
+import integer
+
+# Sliding windows over encrypted images : the whole image is one circuit,
+# so the work shared by neighbouring windows is built once.
+#
+# Kernel file : rows of small integers, '#' starts a comment, and optional
+# lines 'stride <n>' (step between windows, 1 by default) and 'shift <n>'
+# (the result is divided by 2^n, e.g. to normalise a blur).
+#
+# A kernel that is the product of a column and a row (box, binomial blur,
+# Sobel) is applied in two passes : the row sums of a pixel row are shared by
+# every window over it. Runs of equal weights in a row are summed by halves,
+# so that windows side by side share their common runs.
+
+
+class Kernel:
+    def __init__(self, rows, stride=1, shift=0):
+        if not rows or any(len(row) != len(rows[0]) for row in rows):
+            raise ValueError("Le noyau doit être un rectangle d'entiers")
+        self.rows = rows
+        self.stride = stride
+        self.shift = shift
+
+    def separate(self):
+        # Column c and row r with rows[i][j] = c[i] * r[j], or None
+        first = next((row for row in self.rows if any(row)), None)
+        if first is None:
+            return None
+        g = 0
+        for w in first:
+            g = math.gcd(g, w)
+        r = [w // g for w in first]
+        pivot = next(j for j, w in enumerate(r) if w)
+        c = []
+        for row in self.rows:
+            if row[pivot] % r[pivot]:
+                return None
+            ci = row[pivot] // r[pivot]
+            if any(w != ci * rj for w, rj in zip(row, r)):
+                return None
+            c.append(ci)
+        return c, r
+
+
+def parse_kernel(lines, filename="<noyau>"):
+    rows, options = [], {}
+    for number, line in enumerate(lines, 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+        if words[0] in ("stride", "shift"):
+            if len(words) != 2 or not words[1].isdigit():
+                raise ValueError(f"{filename}:{number} : {words[0]} <entier> attendu")
+            if words[0] == "stride" and int(words[1]) < 1:
+                raise ValueError(f"{filename}:{number} : stride d'au moins 1 attendu")
+            options[words[0]] = int(words[1])
+            continue
+        try:
+            rows.append([int(w) for w in words])
+        except ValueError:
+            raise ValueError(f"{filename}:{number} : entiers attendus")
+    return Kernel(rows, options.get("stride", 1), options.get("shift", 0))
+
+
+def load_kernel(filename):
+    with open(filename) as f:
+        return parse_kernel(f, filename)
+
+
+# Sum of weighted values modulo 2^width : terms are (value, weight) with
+# small integer weights, a value is an unsigned word or a carry-save pair of
+# words. Every bit of every term goes into one column reduction, then a
+# carry-lookahead addition, or none when the result is left in carry-save
+# form for the next sum : that saves the depth of the intermediate additions.
+def weighted_sum(b, terms, width, resolve=True):
+    columns = [[] for _ in range(width)]
+    offset = 0
+    words = [(w, weight) for value, weight in terms
+             for w in (value if isinstance(value, tuple) else (value,))]
+    for word, weight in words:
+        for k in range(abs(weight).bit_length()):
+            if not (abs(weight) >> k) & 1:
+                continue
+            if weight > 0:
+                for i, bit in enumerate(word):
+                    if i + k < width:
+                        columns[i + k].append(bit)
+            else:
+                # -(x << k) = ~(x << k) + 1, the ~ of the zeros is a constant
+                for i in range(width - k):
+                    if i < len(word):
+                        columns[i + k].append(b.not_(word[i]))
+                    else:
+                        offset += 1 << (i + k)
+                offset += (1 << k) - 1
+                offset += 1
+    for i in range(width):
+        if (offset >> i) & 1:
+            columns[i].append(b.const(1))
+    r0, r1 = integer.reduce_columns(b, columns, width)
+    if not resolve:
+        return (r0, r1)
+    return integer.add(b, r0, r1)[:width]
+
+
+# Bits of a sum of values in [lo, hi], two's complement when lo < 0
+def sum_width(lo, hi):
+    if lo >= 0:
+        return max(hi.bit_length(), 1)
+    return max(hi.bit_length(), (-lo - 1).bit_length()) + 1
+
+
+def bounds(weights, lo, hi):
+    return (sum(min(w * lo, w * hi) for w in weights),
+            sum(max(w * lo, w * hi) for w in weights))
+
+
+# Weighted sums of a row of words for the windows starting at each x of xs,
+# in carry-save form on width bits : runs of equal weights are split in
+# halves shared between windows
+def row_sums(b, row, weights, xs, hi, width):
+    runs = {}
+
+    def run(x, length):
+        # Sum of row[x : x + length], unsigned
+        if length == 1:
+            return row[x]
+        if (x, length) not in runs:
+            half = 1 << ((length - 1).bit_length() - 1)
+            w = sum_width(0, length * hi)
+            runs[(x, length)] = weighted_sum(b, [(run(x, half), 1), (run(x + half, length - half), 1)], w, False)
+        return runs[(x, length)]
+
+    sums = []
+    for x in xs:
+        terms, j = [], 0
+        while j < len(weights):
+            k = j
+            while k < len(weights) and weights[k] == weights[j]:
+                k += 1
+            if weights[j]:
+                terms.append((run(x + j, k - j), weights[j]))
+            j = k
+        sums.append(weighted_sum(b, terms, width, False))
+    return sums
+
+
+# Convolution of a grid of unsigned words of bits bits (grid[y][x]) by a
+# kernel, over the windows fully inside the grid. Gives the grid of results
+# and their width : |sum| >> shift, unsigned.
+def convolve(b, grid, bits, kernel):
+    kh, kw = len(kernel.rows), len(kernel.rows[0])
+    height, width = len(grid), len(grid[0])
+    if kh > height or kw > width:
+        raise ValueError("Le noyau est plus grand que l'image")
+    ys = range(0, height - kh + 1, kernel.stride)
+    xs = list(range(0, width - kw + 1, kernel.stride))
+    hi = (1 << bits) - 1
+    lo_out, hi_out = bounds([w for row in kernel.rows for w in row], 0, hi)
+    out_width = sum_width(lo_out, hi_out)
+
+    separable = kernel.separate()
+    if separable:
+        c, r = separable
+        # Signed row sums are kept modulo 2^out_width, like the result
+        lo_row, hi_row = bounds(r, 0, hi)
+        row_width = out_width if lo_row < 0 else sum_width(lo_row, hi_row)
+        rows = {}
+        for y in {y + i for y in ys for i in range(kh) if c[i]}:
+            rows[y] = row_sums(b, grid[y], r, xs, hi, row_width)
+        result = [[weighted_sum(b, [(rows[y + i][n], ci) for i, ci in enumerate(c) if ci], out_width)
+                   for n in range(len(xs))] for y in ys]
+    else:
+        result = [[weighted_sum(b, [(grid[y + i][x + j], w)
+                                    for i, row in enumerate(kernel.rows)
+                                    for j, w in enumerate(row) if w], out_width)
+                   for x in xs] for y in ys]
+
+    if lo_out < 0:
+        result = [[absolute(b, v) for v in line] for line in result]
+    return [[v[kernel.shift:] or [b.const(0)] for v in line] for line in result], \
+        max(out_width - kernel.shift, 1)
+
+
+# |x| of a two's complement word
+def absolute(b, word):
+    sign = word[-1]
+    negated = integer.add(b, [b.not_(bit) for bit in word], integer.constant(b, 1, len(word)))[:len(word)]
+    return integer.mux(b, sign, negated, word)
@@ -0,0 +1,81 @@
+# Grayscale images : plain PGM files, and encrypted bit-sliced files where
+# the ciphertexts of bit k of every pixel are contiguous (bit-plane k), so
+# that operations go through the image one plane at a time.
+#
+# Encrypted file (.genc) : a line "gray <width> <height> <bits>", then
+# bits * width * height ciphertexts in decimal, one per line, plane 0 (least
+# significant bits) first, each plane row by row.
+
+SLICED_MAGIC = "gray"
+
+
+# Values of a PGM file, ASCII (P2) or binary (P5) : width, height, bits
+# per pixel and the pixels row by row
+def read_pgm(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    # Header : magic, width, height, maxval, '#' comments allowed
+    fields, pos = [], 0
+    while len(fields) < 4:
+        while pos < len(data) and data[pos:pos+1].isspace():
+            pos += 1
+        if data[pos:pos+1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        start = pos
+        while pos < len(data) and not data[pos:pos+1].isspace():
+            pos += 1
+        fields.append(data[start:pos].decode())
+    magic, width, height, maxval = fields[0], int(fields[1]), int(fields[2]), int(fields[3])
+    if magic not in ("P2", "P5") or not 0 < maxval < 65536:
+        raise ValueError(f"{filename} : PGM P2 ou P5 attendu")
+    count = width * height
+    if magic == "P2":
+        pixels = [int(v) for v in data[pos:].split()]
+    else:
+        size = 2 if maxval > 255 else 1
+        raw = data[pos+1:pos+1+count*size]
+        pixels = [int.from_bytes(raw[i:i+size], "big") for i in range(0, len(raw), size)]
+    if len(pixels) != count or any(v > maxval for v in pixels):
+        raise ValueError(f"{filename} : {count} pixels entre 0 et {maxval} attendus")
+    return width, height, maxval.bit_length(), pixels
+
+
+def write_pgm(filename, width, height, bits, pixels):
+    with open(filename, "w") as f:
+        f.write(f"P2\n{width} {height}\n{(1 << bits) - 1}\n")
+        for i in range(height):
+            f.write(" ".join(str(v) for v in pixels[i*width:(i+1)*width]) + "\n")
+
+
+# Bit-planes of the pixels : planes[k][i] is bit k of pixel i
+def slice_bits(pixels, bits):
+    return [[(v >> k) & 1 for v in pixels] for k in range(bits)]
+
+
+def unslice_bits(planes):
+    return [sum(bit << k for k, bit in enumerate(column)) for column in zip(*planes)]
+
+
+# Encrypted bit-planes, as decimal strings
+def read_sliced(filename):
+    with open(filename) as f:
+        header = f.readline().split()
+        if len(header) != 4 or header[0] != SLICED_MAGIC:
+            raise ValueError(f"{filename} : en-tête '{SLICED_MAGIC} <largeur> <hauteur> <bits>' attendu")
+        width, height, bits = map(int, header[1:])
+        count = width * height
+        planes = []
+        for _ in range(bits):
+            plane = [f.readline().strip() for _ in range(count)]
+            if not plane or not plane[-1]:
+                raise ValueError(f"{filename} : le fichier est trop court")
+            planes.append(plane)
+    return width, height, planes
+
+
+def write_sliced(filename, width, height, planes):
+    with open(filename, "w") as f:
+        f.write(f"{SLICED_MAGIC} {width} {height} {len(planes)}\n")
+        for plane in planes:
+            f.write("\n".join(str(c) for c in plane) + "\n")
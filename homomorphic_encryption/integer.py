@@ -0,0 +1,197 @@
+import random
+import sys
+
+import circuit
+
+# Integers on encrypted bits : a word is a list of signals of a
+# circuit.Builder, least significant bit first. Sums cost no depth, so the
+# operators are laid out to keep the number of products on a path small.
+
+
+def word(b, name, n):
+    return [b.input(f"{name}{i}") for i in range(n)]
+
+
+def constant(b, value, n):
+    return [b.const((value >> i) & 1) for i in range(n)]
+
+
+# Carry of x + y + z : xy + z(x + y), one product deeper than its inputs
+def majority(b, x, y, z):
+    return b.xor(b.and_(x, y), b.and_(z, b.xor(x, y)))
+
+
+def ripple_add(b, x, y, carry=None):
+    carry = b.const(0) if carry is None else carry
+    s = []
+    for xi, yi in zip(x, y):
+        s.append(b.xor(b.xor(xi, yi), carry))
+        carry = majority(b, xi, yi, carry)
+    return s + [carry]
+
+
+# Carries of a sum from the generate and propagate bits, by a Sklansky
+# parallel prefix : depth log2(n) instead of n. G + P * G' needs no OR, the
+# two terms are never both 1.
+def prefix_carries(b, g, p):
+    g, p = list(g), list(p)
+    n, span = len(g), 1
+    while span < n:
+        for i in range(n):
+            if i & span:
+                j = (i & ~(span - 1)) - 1
+                g[i] = b.xor(g[i], b.and_(p[i], g[j]))
+                p[i] = b.and_(p[i], p[j])
+        span <<= 1
+    return g
+
+
+# Carry-lookahead adder, n + 1 bits
+def cla_add(b, x, y, carry=None):
+    p = [b.xor(xi, yi) for xi, yi in zip(x, y)]
+    g = [b.and_(xi, yi) for xi, yi in zip(x, y)]
+    if carry is not None:
+        p, g = [b.const(0)] + p, [carry] + g
+    carries = prefix_carries(b, g, p)
+    if carry is not None:
+        p = p[1:]
+    else:
+        carries = [b.const(0)] + carries
+    return [b.xor(pi, ci) for pi, ci in zip(p, carries)] + [carries[-1]]
+
+
+ADDERS = {"ripple": ripple_add, "cla": cla_add}
+
+
+def add(b, x, y, kind="cla"):
+    return ADDERS[kind](b, x, y)
+
+
+# x - y on n bits, and x >= y
+def sub(b, x, y, kind="cla"):
+    s = ADDERS[kind](b, x, [b.not_(yi) for yi in y], b.const(1))
+    return s[:-1], s[-1]
+
+
+def less_than(b, x, y, kind="cla"):
+    return b.not_(sub(b, x, y, kind)[1])
+
+
+def equal(b, x, y):
+    return b.tree("and", [b.not_(b.xor(xi, yi)) for xi, yi in zip(x, y)])
+
+
+# s ? x : y
+def mux(b, s, x, y):
+    return [b.xor(yi, b.and_(s, b.xor(xi, yi))) for xi, yi in zip(x, y)]
+
+
+# Reduces columns of bits of equal weight to two rows with full and half
+# adders (Wallace tree), the shallowest bits first
+def reduce_columns(b, columns, width):
+    columns = [list(c) for c in columns[:width]] + [[] for _ in range(width - len(columns))]
+    while any(len(c) > 2 for c in columns):
+        next_columns = [[] for _ in range(width)]
+        for i, column in enumerate(columns):
+            column.sort(key=lambda s: b.depth[s])
+            while len(column) >= 3:
+                x, y, z = column.pop(0), column.pop(0), column.pop(0)
+                next_columns[i].append(b.xor(b.xor(x, y), z))
+                if i + 1 < width:
+                    next_columns[i + 1].append(majority(b, x, y, z))
+            # A pair left with other bits of this weight : half adder
+            if len(column) == 2 and next_columns[i]:
+                x, y = column.pop(0), column.pop(0)
+                next_columns[i].append(b.xor(x, y))
+                if i + 1 < width:
+                    next_columns[i + 1].append(b.and_(x, y))
+            next_columns[i] += column
+        columns = next_columns
+    zero = b.const(0)
+    return [[c[k] if k < len(c) else zero for c in columns] for k in range(2)]
+
+
+# Product on width bits, len(x) + len(y) by default
+def multiply(b, x, y, width=None, kind="cla"):
+    width = width or len(x) + len(y)
+    columns = [[] for _ in range(width)]
+    for i, xi in enumerate(x):
+        for j, yj in enumerate(y):
+            if i + j < width:
+                columns[i + j].append(b.and_(xi, yj))
+    r0, r1 = reduce_columns(b, columns, width)
+    return ADDERS[kind](b, r0, r1)[:width]
+
+
+# Number of bits set
+def popcount(b, bits, kind="cla"):
+    width = max(len(bits).bit_length(), 1)
+    r0, r1 = reduce_columns(b, [bits], width)
+    return ADDERS[kind](b, r0, r1)[:width]
+
+
+# Circuit of one operator on n-bit words, outputs r0, r1, ... least
+# significant first, for the command line and the server
+def build(op, n, kind="cla"):
+    b = circuit.Builder()
+    if op == "popcount":
+        r = popcount(b, word(b, "x", n), kind)
+    elif op == "mux":
+        s = b.input("s")
+        r = mux(b, s, word(b, "x", n), word(b, "y", n))
+    else:
+        x, y = word(b, "x", n), word(b, "y", n)
+        if op == "add":
+            r = add(b, x, y, kind)
+        elif op == "sub":
+            r = sub(b, x, y, kind)[0]
+        elif op == "lt":
+            r = [less_than(b, x, y, kind)]
+        elif op == "eq":
+            r = [equal(b, x, y)]
+        elif op == "mul":
+            r = multiply(b, x, y, kind=kind)
+        else:
+            raise ValueError(f"opération inconnue '{op}'")
+    b.circuit.outputs = [(f"r{i}", g) for i, g in enumerate(r)]
+    return circuit.optimise(b.circuit)
+
+
+# Expected result of build(op, n) on plain integers
+def reference(op, n, values):
+    mask = (1 << n) - 1
+    if op == "popcount":
+        return bin(values[0]).count("1")
+    if op == "mux":
+        s, x, y = values
+        return x if s else y
+    x, y = values
+    return {"add": x + y, "sub": (x - y) & mask, "lt": int(x < y),
+            "eq": int(x == y), "mul": x * y}[op]
+
+
+def check(op, n, c, tries=200):
+    sizes = [n] if op == "popcount" else [1, n, n] if op == "mux" else [n, n]
+    for _ in range(tries):
+        values = [random.getrandbits(size) for size in sizes]
+        bits = [(v >> i) & 1 for v, size in zip(values, sizes) for i in range(size)]
+        out = circuit.evaluate(c, bits, circuit.PLAIN_GATES)
+        if sum(bit << i for i, bit in enumerate(out)) != reference(op, n, values):
+            return False
+    return True
+
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (3, 4):
+        print("Usage: python3 integer.py <add | sub | lt | eq | mux | mul | popcount> <bits> [ripple | cla]")
+        sys.exit(1)
+    op, n = sys.argv[1], int(sys.argv[2])
+    kind = sys.argv[3] if len(sys.argv) == 4 else "cla"
+    c = build(op, n, kind)
+    s = c.stats()
+    print(f"{op} {n} bits ({kind}) : {s['and']} and, {s['xor']} xor, {s['not']} not, profondeur {s['depth']}")
+    print("  " + ", ".join(f"{name} : {d}" for name, d in circuit.output_depths(c)))
+    if not check(op, n, c):
+        print("Erreur : résultat incorrect")
+        sys.exit(1)
+    print("Résultats vérifiés sur des entrées aléatoires")
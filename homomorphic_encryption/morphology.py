@@ -0,0 +1,149 @@
+import circuit
+
+# Erosion and dilation of encrypted binary images by a structuring element,
+# and opening and closing built from them. The whole image is one circuit.
+#
+# Element file : rows of 0 and 1, '#' starts a comment, the origin is the
+# centre (odd sizes) unless a line 'origin <row> <column>' gives it.
+#
+# Erosion is the AND of the pixels under the element, dilation the OR of the
+# pixels under the reflected element, pixels outside the image being neutral
+# (1 for erosion, 0 for dilation). Each row of the element is a set of runs
+# of pixels; the AND (or OR) of a run of length L is that of two runs of
+# length 2^k overlapping, 2^k <= L < 2^(k+1), which is possible because the
+# operators are idempotent. The runs of length 2^k of an image row are built
+# once from those of length 2^(k-1) and shared by every window, and the runs
+# of a window are combined as a tree : the depth is ceil(log2(size)).
+
+
+class Element:
+    def __init__(self, rows, origin=None):
+        if not rows or any(len(row) != len(rows[0]) for row in rows) \
+                or any(v not in (0, 1) for row in rows for v in row):
+            raise ValueError("L'élément structurant doit être un rectangle de 0 et de 1")
+        self.rows = rows
+        self.origin = origin or (len(rows) // 2, len(rows[0]) // 2)
+
+    # Runs (dy, dx, length) of the element relative to its origin
+    def runs(self):
+        oy, ox = self.origin
+        result = []
+        for i, row in enumerate(self.rows):
+            j = 0
+            while j < len(row):
+                if row[j]:
+                    k = j
+                    while k < len(row) and row[k]:
+                        k += 1
+                    result.append((i - oy, j - ox, k - j))
+                    j = k
+                else:
+                    j += 1
+        return result
+
+    # Element rotated by 180 degrees around its origin
+    def reflected(self):
+        oy, ox = self.origin
+        rows = [row[::-1] for row in self.rows[::-1]]
+        return Element(rows, (len(self.rows) - 1 - oy, len(self.rows[0]) - 1 - ox))
+
+
+def parse_element(lines, filename="<élément>"):
+    rows, origin = [], None
+    for number, line in enumerate(lines, 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+        if words[0] == "origin":
+            if len(words) != 3 or not all(w.isdigit() for w in words[1:]):
+                raise ValueError(f"{filename}:{number} : origin <ligne> <colonne> attendu")
+            origin = (int(words[1]), int(words[2]))
+            continue
+        if len(words) == 1 and len(words[0]) > 1:
+            words = list(words[0])  # Rows written as 0110
+        try:
+            rows.append([int(w) for w in words])
+        except ValueError:
+            raise ValueError(f"{filename}:{number} : 0 ou 1 attendus")
+    return Element(rows, origin)
+
+
+def load_element(filename):
+    with open(filename) as f:
+        return parse_element(f, filename)
+
+
+# Runs of one image row for an idempotent op, power-of-two lengths shared
+class RowRuns:
+    def __init__(self, b, row, op):
+        self.b, self.op = b, op
+        self.levels = [list(row)]  # levels[k][x] : row[x : x + 2^k]
+
+    def power(self, x, k):
+        while len(self.levels) <= k:
+            prev, span = self.levels[-1], 1 << (len(self.levels) - 1)
+            self.levels.append([self.b.tree(self.op, [prev[i], prev[i + span]])
+                                for i in range(len(prev) - span)])
+        return self.levels[k][x]
+
+    # op of row[x : x + length], clipped to the row, None when empty
+    def run(self, x, length):
+        end = min(x + length, len(self.levels[0]))
+        x = max(x, 0)
+        if end <= x:
+            return None
+        k = (end - x).bit_length() - 1
+        first = self.power(x, k)
+        if end - x == 1 << k:
+            return first
+        return self.b.tree(self.op, [first, self.power(end - (1 << k), k)])
+
+
+def apply(b, grid, element, op):
+    height, width = len(grid), len(grid[0])
+    rows = [RowRuns(b, row, op) for row in grid]
+    runs = element.runs()
+    result = []
+    for y in range(height):
+        line = []
+        for x in range(width):
+            leaves = []
+            for dy, dx, length in runs:
+                if 0 <= y + dy < height:
+                    value = rows[y + dy].run(x + dx, length)
+                    if value is not None:
+                        leaves.append(value)
+            line.append(b.tree(op, leaves))
+        result.append(line)
+    return result
+
+
+# Grids of signals grid[y][x], images of the same size
+def erode(b, grid, element):
+    return apply(b, grid, element, "and")
+
+
+def dilate(b, grid, element):
+    return apply(b, grid, element.reflected(), "or")
+
+
+def opening(b, grid, element):
+    return dilate(b, erode(b, grid, element), element)
+
+
+def closing(b, grid, element):
+    return erode(b, dilate(b, grid, element), element)
+
+
+OPERATIONS = {"erode": erode, "dilate": dilate, "open": opening, "close": closing}
+
+
+# Circuit of an operation on a width x height image, inputs and outputs row
+# by row
+def build(operation, width, height, element):
+    b = circuit.Builder()
+    pixels = [b.input(f"p{i}") for i in range(width * height)]
+    grid = [pixels[y*width:(y+1)*width] for y in range(height)]
+    result = OPERATIONS[operation](b, grid, element)
+    b.circuit.outputs = [(f"r{y}_{x}", g) for y, line in enumerate(result) for x, g in enumerate(line)]
+    return circuit.optimise(b.circuit)
@@ -4,6 +4,8 @@ import sys
 import subprocess
 import os
 
+import image_format
+
 sys.set_int_max_str_digits(10**6)
 CLIENT_PATH = "./homomorphic_encryption/client"
 
@@ -102,7 +104,25 @@ def decrypt_image(encrypted_filename, p):
     except Exception as e:
         print(str(e))
         return None
-      
+
+# Encrypts a grayscale PGM image to a bit-sliced file
+def encrypt_gray_image(input_filename, p):
+    width, height, bits, pixels = image_format.read_pgm(input_filename)
+    planes = [[encrypt_with_client(bit, p) for bit in plane] for plane in image_format.slice_bits(pixels, bits)]
+    output_filename = os.path.splitext(os.path.basename(input_filename))[0] + ".genc"
+    image_format.write_sliced(output_filename, width, height, planes)
+    print(f"Chiffrement réussi. {width}x{height} pixels sur {bits} bits écrits dans {output_filename}")
+    return output_filename
+
+# Decrypts a bit-sliced file to a grayscale PGM image
+def decrypt_gray_image(encrypted_filename, p):
+    width, height, planes = image_format.read_sliced(encrypted_filename)
+    planes = [[decrypt_with_client(c, p) for c in plane] for plane in planes]
+    output_filename = os.path.basename(encrypted_filename).replace(".genc", ".pgm")
+    image_format.write_pgm(output_filename, width, height, len(planes), image_format.unslice_bits(planes))
+    print(f"Résultat déchiffré sauvegardé dans {output_filename}")
+    return output_filename
+
 if __name__ == "__main__":
     if len(sys.argv) != 3:
         print("Usage: python3 read_image.py <encrypt> | <decrypt> <image>")
@@ -113,7 +133,11 @@ if __name__ == "__main__":
         print("Usage: python3 read_image.py <encrypt> | <decrypt> <image>")
         sys.exit(1)
     image_filename = sys.argv[2]
-    if action == "encrypt":
+    if action == "encrypt" and image_filename.endswith(".pgm"):
+        encrypt_gray_image(image_filename, p)
+    elif action == "decrypt" and image_filename.endswith(".genc"):
+        decrypt_gray_image(image_filename, p)
+    elif action == "encrypt":
         encrypt_image(image_filename, p)
     elif action == "decrypt":
         decrypt_image(image_filename, p)
@@ -0,0 +1,28 @@
+import json
+import os
+import socket
+import sys
+
+# Sends an action to the server started by 'python3 server.py serve', which
+# keeps the public key loaded : same arguments as server.py, run from the
+# current directory. Does not read the key itself.
+SOCKET_PATH = os.environ.get("SERVER_SOCKET", "server.sock")
+
+def request(argv, path=SOCKET_PATH):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(path)
+        s.sendall((json.dumps({"cwd": os.getcwd(), "argv": ["server.py"] + argv}) + "\n").encode())
+        with s.makefile() as f:
+            reply = f.readline()
+    if not reply:
+        raise ConnectionError("Le serveur a fermé la connexion sans répondre")
+    return json.loads(reply)
+
+if __name__ == "__main__":
+    try:
+        reply = request(sys.argv[1:])
+    except (FileNotFoundError, ConnectionRefusedError):
+        print(f"Pas de serveur sur {SOCKET_PATH} : python3 server.py serve")
+        sys.exit(1)
+    print(reply["output"], end="")
+    sys.exit(reply["status"])
@@ -1,23 +1,41 @@
+import contextlib
+import functools
+import io
 import json
+import multiprocessing
+import os
 import random
+import signal
+import socketserver
+import stat
 import sys
-from decimal import Decimal
+import traceback
+from concurrent.futures import ProcessPoolExecutor
+
+import cache
+import circuit
+import convolution
+import image_format
+import integer
+import morphology
 
 # Parameters
 sys.set_int_max_str_digits(10**6)
 N_BITS_PREC = 11
 WEIGHT = 32
 
-# Public key
-with open("pk.json") as f:
-    pk_data = json.load(f)
+# Public key, read on first use : sums and products of ciphertexts need
+# none of it, only fresh encryptions need pk_star
+class PublicKey:
+    def __init__(self, filename):
+        self.filename = filename
 
-pk_star = list(map(int, pk_data["pk_star"]))
-y = list(map(Decimal, pk_data["y"]))
+    @functools.cached_property
+    def pk_star(self):
+        with open(self.filename) as f:
+            return list(map(int, json.load(f)["pk_star"]))
 
-TAU = len(pk_star) - 1
-THETA = len(y)
-x0 = pk_star[0]
+KEY = PublicKey("pk.json")
 
 # Public encryption
 def encrypt_public(m, pk, TAU=8320, RHOP=32):
@@ -47,56 +65,158 @@ def xor_h(a, b):
 def or_h(a,b):
     return (a+b) + (a*b)
 
+# Fresh encryptions of 0 and 1, a few made once and drawn at random : a NOT
+# adds an encryption of 1, which needs no subset sum of its own per gate
+POOL_SIZE = 8
+ENCRYPTIONS = {}
+
+def encryptions(m):
+    if m not in ENCRYPTIONS:
+        ENCRYPTIONS[m] = [encrypt_public(m, KEY.pk_star) for _ in range(POOL_SIZE)]
+    return ENCRYPTIONS[m]
+
+def fresh(m):
+    return random.choice(encryptions(m))
+
 def not_h(a):
-    x = encrypt_public(1, pk_star)
+    x = fresh(1)
     return (a+x)
 
 def add_noise(a):
-    x = encrypt_public(0, pk_star)
+    x = fresh(0)
     return (a+x)
 
-def compress(a,b,c,d):
-    cond1 = (a*b)
-    cond2 = (c*d)
-    cond3 = (a+b)*(c+d)
-    or1 = or_h(cond1, cond2)
-    return or_h(or1, cond3)
-
-def compress_black(a,b,c,d):
-    pre1 = (a*b)
-    pre2 = (c*d)
-    or1 = or_h(pre1*c, pre1*d)
-    or2 = or_h(pre2*a, pre2*b)
-    return or_h(or1, or2) 
-
-# In theory, should keep the same bit, but we have no bootstrap
-def destroy_bit(a):
-    x = a
-    for _ in range(25):
-        x = x * a
-    return x
+# Gates of the circuits, on ciphertexts
+GATES = {
+    "const": fresh,
+    "not": not_h,
+    "xor": xor_h,
+    "and": and_h,
+}
 
-def compress_function(img):
+CIRCUIT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "circuits")
+
+# Circuit of a file, optimised once
+def load_circuit(filename):
+    if not os.path.exists(filename):
+        filename = os.path.join(CIRCUIT_DIR, filename)
+    return circuit.optimise(circuit.load(filename))
+
+# Circuit given as text
+def inline_circuit(text, **options):
+    return circuit.optimise(circuit.parse(text.split("\n")), **options)
+
+INVERT = inline_circuit("inputs a\nr = not a\noutputs r")
+ADD = inline_circuit("inputs a b\nr = or a b\noutputs r")
+XOR = inline_circuit("inputs a b\nr = xor a b\noutputs r")
+MULTIPLY = inline_circuit("inputs a b\nr = and a b\noutputs r")
+
+# In theory, should keep the same bit, but we have no bootstrap : a^26, as
+# a product tree of depth 5 rather than the chain x = x * a of depth 25
+DESTROY = inline_circuit("inputs a\nr = and " + " ".join(["a"] * 26) + "\noutputs r", fold=False)
+
+# Pixels and blocks are evaluated by worker processes, Python products hold
+# the GIL. Idle workers take the next task, so the load stays balanced.
+WORKERS = int(os.environ.get("SERVER_WORKERS", os.cpu_count() or 1))
+
+# Ciphertexts already computed, by content, in the directory SERVER_CACHE if
+# given, one subdirectory per public key, shared by successive runs over the
+# same images. Those read stay in memory up to SERVER_CACHE_MB
+CACHE_DIR = os.environ.get("SERVER_CACHE")
+if CACHE_DIR:
+    CACHE_DIR = os.path.abspath(CACHE_DIR)  # The requests served chdir
+CACHE_LIMIT = int(os.environ.get("SERVER_CACHE_MB", 1024)) << 20
+CACHE = cache.Cache(CACHE_DIR, CACHE_LIMIT, cache.fingerprint(KEY.filename)) if CACHE_DIR else None
+
+def apply_gate(op, *args):
+    return GATES[op](*args)
+
+# Run by the workers too : the values computed go to the directory from there
+def evaluate_task(task):
+    circ, inputs, known, missing = task
+    record = CACHE.recorder(missing) if missing else None
+    return circuit.evaluate(circ, inputs, GATES, known, record)
+
+# Evaluates a circuit on each list of inputs, gives the list of the outputs
+# of each. With fewer tasks than workers,
+# the independent gates of each circuit run concurrently instead. Circuits
+# made of additions only are cheaper than the transfers and stay here.
+# Values found in the cache are not computed again, nor the gates below them.
+def evaluate_all(circ, tasks):
+    depths = circuit.output_depths(circ)
+    if len(depths) <= 8:
+        print("Profondeur multiplicative : " + ", ".join(f"{name} {depth}" for name, depth in depths))
+    else:
+        print(f"Profondeur multiplicative : {max(d for _, d in depths)} au plus sur {len(depths)} sorties")
+    if CACHE is None:
+        work = [(circ, inputs, None, None) for inputs in tasks]
+    else:
+        work = []
+        for inputs in tasks:
+            k = cache.gate_keys(circ, inputs)
+            known = CACHE.lookup(circ, k)
+            work.append((circ, inputs, known, CACHE.missing(circ, k, known)))
+
+    # Tasks whose outputs are all known cost nothing
+    results = [None] * len(work)
+    todo = []
+    for i, task in enumerate(work):
+        if task[3] is not None and not task[3]:
+            results[i] = evaluate_task(task)
+        else:
+            todo.append(i)
+    if CACHE is not None:
+        print(f"Cache : {sum(len(task[2]) for task in work)} valeurs retrouvées, {len(todo)} évaluations sur {len(work)} à faire")
+    # Fresh encryptions made here once, not by every worker
+    if todo:
+        for op, args in circ.gates:
+            if op == "not":
+                encryptions(1)
+            elif op == "const":
+                encryptions(args[0])
+    if WORKERS <= 1 or all(op in ("input", "xor") for op, _ in circ.gates):
+        for i in todo:
+            results[i] = evaluate_task(work[i])
+    else:
+        # Forked, the workers inherit the key and the fresh encryptions; they
+        # would also share the state of random, hence the reseeding
+        with ProcessPoolExecutor(WORKERS, multiprocessing.get_context("fork"), initializer=random.seed) as pool:
+            if len(todo) >= WORKERS:
+                for i, result in zip(todo, pool.map(evaluate_task, [work[i] for i in todo])):
+                    results[i] = result
+            else:
+                for i in todo:
+                    _, inputs, known, missing = work[i]
+                    record = CACHE.recorder(missing) if missing else None
+                    results[i] = circuit.evaluate_dag(circ, inputs, apply_gate, pool, known=known, record=record)
+    return results
+
+# Evaluates a circuit of 4 inputs on each 2x2 block, a b the left column and
+# c d the right one, its output fills the block
+def block_function(img, circ):
+    blocks = [[int(img[2*i][2*j]), int(img[2*i+1][2*j]), int(img[2*i][2*j+1]), int(img[2*i+1][2*j+1])] for i in range(8) for j in range(8)]
+    results = evaluate_all(circ, blocks)
     new_img = [[str(0) for _ in range(16)] for _ in range(16)]
     for i in range(8):
         for j in range(8):
-            compressed = compress(int(img[2*i][2*j]), int(img[2*i+1][2*j]), int(img[2*i][2*j+1]), int(img[2*i+1][2*j+1]))
-            new_img[2*i][2*j] = str(compressed)
-            new_img[2*i+1][2*j] = str(compressed)
-            new_img[2*i][2*j+1] = str(compressed)
-            new_img[2*i+1][2*j+1] = str(compressed)
+            compressed = str(results[8*i + j][0])
+            new_img[2*i][2*j] = compressed
+            new_img[2*i+1][2*j] = compressed
+            new_img[2*i][2*j+1] = compressed
+            new_img[2*i+1][2*j+1] = compressed
     return new_img
 
+# Evaluates a circuit of 1 or 2 inputs on each pixel of the images
+def pixel_function(imgs, circ):
+    pixels = [[int(img[i][j]) for img in imgs] for i in range(16) for j in range(16)]
+    results = evaluate_all(circ, pixels)
+    return [[str(results[16*i + j][0]) for j in range(16)] for i in range(16)]
+
+def compress_function(img):
+    return block_function(img, load_circuit("compress.circ"))
+
 def compress_black_function(img):
-    new_img = [[str(0) for _ in range(16)] for _ in range(16)]
-    for i in range(8):
-        for j in range(8):
-            compressed = compress_black(int(img[2*i][2*j]), int(img[2*i+1][2*j]), int(img[2*i][2*j+1]), int(img[2*i+1][2*j+1]))
-            new_img[2*i][2*j] = str(compressed)
-            new_img[2*i+1][2*j] = str(compressed)
-            new_img[2*i][2*j+1] = str(compressed)
-            new_img[2*i+1][2*j+1] = str(compressed)
-    return new_img
+    return block_function(img, load_circuit("compress_black.circ"))
 
 def load_encrypted_image(encrypted_filename):
     encrypted_image = [[None for _ in range(16)] for _ in range(16)]
@@ -112,7 +232,7 @@ def load_encrypted_image(encrypted_filename):
 
 def invert_image(image_filename):
     image = load_encrypted_image(image_filename)
-    inverted_image = [str(not_h(int(image[i][j]))) for i in range(16) for j in range(16)]
+    inverted_image = [pixel for row in pixel_function([image], INVERT) for pixel in row]
     output_filename = image_filename.replace(".enc", "_invert.enc")
     with open(output_filename, "w") as f:
         f.write("\n".join(inverted_image))
@@ -121,7 +241,7 @@ def add_images(image1_filename, image2_filename):
     image1 = load_encrypted_image(image1_filename)
     image2 = load_encrypted_image(image2_filename)
     
-    added_image = [[str(or_h(int(image1[i][j]), int(image2[i][j]))) for j in range(16)] for i in range(16)]
+    added_image = pixel_function([image1, image2], ADD)
     base1 = image1_filename[:-4]
     base2 = image2_filename[:-4]
     output_filename = f"{base1}+{base2}_add.enc"
@@ -133,7 +253,7 @@ def xor_images(image1_filename, image2_filename):
     image1 = load_encrypted_image(image1_filename)
     image2 = load_encrypted_image(image2_filename)
     
-    xor_image = [[str(xor_h(int(image1[i][j]), int(image2[i][j]))) for j in range(16)] for i in range(16)]
+    xor_image = pixel_function([image1, image2], XOR)
     base1 = image1_filename[:-4]
     base2 = image2_filename[:-4]
     output_filename = f"{base1}+{base2}_xor.enc"
@@ -145,7 +265,7 @@ def multiply_images(image1_filename, image2_filename):
     image1 = load_encrypted_image(image1_filename)
     image2 = load_encrypted_image(image2_filename)
     
-    multiplied_image = [[str(and_h(int(image1[i][j]), int(image2[i][j]))) for j in range(16)] for i in range(16)]
+    multiplied_image = pixel_function([image1, image2], MULTIPLY)
     base1 = image1_filename[:-4]
     base2 = image2_filename[:-4]
     output_filename = f"{base1}+{base2}_multiply.enc"
@@ -171,25 +291,196 @@ def compress_black_image(image_filename):
             
 def destroy_image(image_filename):
     image = load_encrypted_image(image_filename)
-    inverted_image = [str(destroy_bit(int(image[i][j]))) for i in range(16) for j in range(16)]
+    inverted_image = [pixel for row in pixel_function([image], DESTROY) for pixel in row]
     output_filename = image_filename.replace(".enc", "_destroy.enc")
     with open(output_filename, "w") as f:
         f.write("\n".join(inverted_image))
 
+# Applies a circuit file : 4 inputs work on the 2x2 blocks of one image,
+# 1 or 2 inputs on the pixels of one or two images
+def circuit_image(circuit_filename, image_filenames):
+    circ = load_circuit(circuit_filename)
+    n = len(circ.inputs)
+    if n not in (1, 2, 4) or len(circ.outputs) != 1:
+        raise ValueError("Le circuit doit avoir 1, 2 ou 4 entrées et une sortie")
+    if len(image_filenames) != (2 if n == 2 else 1):
+        raise ValueError(f"Le circuit attend {2 if n == 2 else 1} image(s)")
+    images = [load_encrypted_image(name) for name in image_filenames]
+    if n == 4:
+        result = block_function(images[0], circ)
+    else:
+        result = pixel_function(images, circ)
+    name = os.path.splitext(os.path.basename(circuit_filename))[0]
+    bases = "+".join(filename[:-4] for filename in image_filenames)
+    output_filename = f"{bases}_circuit_{name}.enc"
+    with open(output_filename, "w") as f:
+        for row in result:
+            f.write("\n".join(row) + "\n")
 
-if __name__ == "__main__":
-    if len(sys.argv) < 2:
+# Circuit on the bits of one pixel of each image, least significant first,
+# body(builder, words) gives the output bits
+def gray_circuit(bits, count, body):
+    b = circuit.Builder()
+    words = [integer.word(b, name, bits) for name in "xy"[:count]]
+    b.circuit.outputs = [(f"r{i}", g) for i, g in enumerate(body(b, words))]
+    return circuit.optimise(b.circuit)
+
+# Evaluates a circuit on each pixel of bit-sliced images, the outputs are
+# the planes of the result. A circuit of one input per bit goes plane by
+# plane, without gathering the bits of the pixels.
+def gray_function(images, circ):
+    planes = [plane for image in images for plane in image]
+    if len(circ.inputs) == 1:
+        results = evaluate_all(circ, [[int(c)] for plane in planes for c in plane])
+        count = len(planes[0])
+        return [[str(r[0]) for r in results[k*count:(k+1)*count]] for k in range(len(planes))]
+    results = evaluate_all(circ, [[int(c) for c in pixel] for pixel in zip(*planes)])
+    return [[str(r[k]) for r in results] for k in range(len(circ.outputs))]
+
+def load_gray_images(image_filenames):
+    images = [image_format.read_sliced(name) for name in image_filenames]
+    width, height, planes = images[0]
+    if any(w != width or h != height or len(p) != len(planes) for w, h, p in images):
+        raise ValueError("Les images doivent avoir les mêmes dimensions et le même nombre de bits")
+    return width, height, [p for _, _, p in images]
+
+def gray_output_name(image_filenames, action):
+    return "+".join(os.path.splitext(name)[0] for name in image_filenames) + f"_{action}.genc"
+
+# 2^bits - 1 - x, plane by plane
+def gray_invert_image(image_filename):
+    width, height, (planes,) = load_gray_images([image_filename])
+    result = gray_function([planes], INVERT)
+    image_format.write_sliced(gray_output_name([image_filename], "invert"), width, height, result)
+
+# x + y on bits + 1 bits
+def gray_add_images(image1_filename, image2_filename):
+    width, height, images = load_gray_images([image1_filename, image2_filename])
+    circ = gray_circuit(len(images[0]), 2, lambda b, w: integer.add(b, w[0], w[1]))
+    result = gray_function(images, circ)
+    image_format.write_sliced(gray_output_name([image1_filename, image2_filename], "add"), width, height, result)
+
+# Binary image, 1 where x >= threshold
+def gray_threshold_image(image_filename, threshold):
+    width, height, (planes,) = load_gray_images([image_filename])
+    bits = len(planes)
+
+    def body(b, w):
+        # Outside the pixel range the result is the same for every pixel
+        if threshold <= 0:
+            return [b.const(1)]
+        if threshold >> bits:
+            return [b.const(0)]
+        return [b.not_(integer.less_than(b, w[0], integer.constant(b, threshold, bits)))]
+
+    circ = gray_circuit(bits, 1, body)
+    result = gray_function([planes], circ)
+    image_format.write_sliced(gray_output_name([image_filename], "threshold"), width, height, result)
+
+# A file given by its path, or by its name in directory, .txt optional
+def find_file(filename, directory):
+    if os.path.exists(filename):
+        return filename
+    for name in (filename, filename + ".txt"):
+        if os.path.exists(os.path.join(directory, name)):
+            return os.path.join(directory, name)
+    return filename  # Reported missing by the loader
+
+KERNEL_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "kernels")
+
+# Bit-planes of an encrypted image, binary (.enc, 16x16) or bit-sliced
+def load_planes(image_filename):
+    if image_filename.endswith(".genc"):
+        return image_format.read_sliced(image_filename)
+    image = load_encrypted_image(image_filename)
+    return 16, 16, [[c for row in image for c in row]]
+
+# Convolution of an image by a kernel file, over the windows inside the
+# image : the whole image is one circuit, whose gates run on the pool
+def convolve_image(image_filename, kernel_filename):
+    kernel_filename = find_file(kernel_filename, KERNEL_DIR)
+    kernel = convolution.load_kernel(kernel_filename)
+    width, height, planes = load_planes(image_filename)
+    bits = len(planes)
+
+    b = circuit.Builder()
+    pixels = [integer.word(b, f"p{i}_", bits) for i in range(width * height)]
+    grid = [pixels[y*width:(y+1)*width] for y in range(height)]
+    result, out_bits = convolution.convolve(b, grid, bits, kernel)
+    b.circuit.outputs = [(f"r{k}_{y}_{x}", v[k]) for k in range(out_bits) for y, line in enumerate(result) for x, v in enumerate(line)]
+    circ = circuit.optimise(b.circuit)
+
+    inputs = [int(planes[k][i]) for i in range(width * height) for k in range(bits)]
+    outputs = evaluate_all(circ, [inputs])[0]
+    count = len(result) * len(result[0])
+    out_planes = [[str(c) for c in outputs[k*count:(k+1)*count]] for k in range(out_bits)]
+    name = os.path.splitext(os.path.basename(kernel_filename))[0]
+    output_filename = os.path.splitext(image_filename)[0] + f"_{name}.genc"
+    image_format.write_sliced(output_filename, len(result[0]), len(result), out_planes)
+
+
+ELEMENT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "elements")
+
+# Erosion, dilation, opening or closing of a binary image (.enc, or .genc of
+# one plane) by a structuring element file, the result has the same format
+def morphology_image(operation, image_filename, element_filename):
+    element_filename = find_file(element_filename, ELEMENT_DIR)
+    element = morphology.load_element(element_filename)
+    width, height, planes = load_planes(image_filename)
+    if len(planes) != 1:
+        raise ValueError("Image binaire attendue (un seul plan)")
+
+    circ = morphology.build(operation, width, height, element)
+    result = [str(c) for c in evaluate_all(circ, [[int(c) for c in planes[0]]])[0]]
+    name = os.path.splitext(os.path.basename(element_filename))[0]
+    base, extension = os.path.splitext(image_filename)
+    output_filename = f"{base}_{operation}_{name}{extension}"
+    if extension == ".genc":
+        image_format.write_sliced(output_filename, width, height, [result])
+    else:
+        with open(output_filename, "w") as f:
+            f.write("\n".join(result))
+
+
+# Runs the action of a command line, gives the exit status
+def main(argv):
+    if len(argv) == 4 and argv[1] in morphology.OPERATIONS:
+        morphology_image(argv[1], argv[2], argv[3])
+        return 0
+    if len(argv) == 4 and argv[1] == "convolve":
+        convolve_image(argv[2], argv[3])
+        return 0
+    if len(argv) >= 4 and argv[1] == "circuit":
+        circuit_image(argv[2], argv[3:])
+        return 0
+    if len(argv) >= 3 and argv[1].startswith("gray_"):
+        if argv[1] == "gray_invert":
+            gray_invert_image(argv[2])
+        elif argv[1] == "gray_add" and len(argv) == 4:
+            gray_add_images(argv[2], argv[3])
+        elif argv[1] == "gray_threshold" and len(argv) == 4:
+            gray_threshold_image(argv[2], int(argv[3]))
+        else:
+            print("Usage: python3 server.py <gray_invert | gray_add | gray_threshold> <img1.genc> [img2.genc | seuil]")
+            return 1
+        return 0
+    if len(argv) < 2:
         print("Usage: python3 server.py <invert | compress | compress_black | destroy | add | xor | multiply> <img1> [img2]")
-        sys.exit(1)
+        print("       python3 server.py circuit <circuit.circ> <img1> [img2]")
+        print("       python3 server.py <gray_invert | gray_add | gray_threshold> <img1.genc> [img2.genc | seuil]")
+        print("       python3 server.py convolve <img> <noyau.txt>")
+        print("       python3 server.py <erode | dilate | open | close> <img> <élément.txt>")
+        print("       python3 server.py serve [socket], puis python3 remote.py <action> ...")
+        return 1
 
-    action = sys.argv[1]
+    action = argv[1]
     if action not in ["invert", "compress", "compress_black", "destroy", "add", "xor", "multiply"]:
         print("Usage: python3 server.py <invert | compress | compress_black | destroy | add | xor | multiply> <img1> [img2]")
-        sys.exit(1)
-    img1 = sys.argv[2]
+        return 1
+    img1 = argv[2]
     img2 = None
-    if len(sys.argv) > 3:
-        img2 = sys.argv[3]
+    if len(argv) > 3:
+        img2 = argv[3]
     if action == "invert":
         invert_image(img1)
     if action == "compress":
@@ -204,3 +495,55 @@ if __name__ == "__main__":
         xor_images(img1, img2)
     elif action == "multiply":
         multiply_images(img1, img2)
+    return 0
+
+
+# Persistent server : the public key and the modules are loaded once, each
+# request runs in a forked process, from the directory of the client, with
+# the arguments of server.py. Requests are sent by remote.py.
+SOCKET_PATH = os.environ.get("SERVER_SOCKET", "server.sock")
+
+class RequestHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        request = json.loads(self.rfile.readline())
+        output = io.StringIO()
+        with contextlib.redirect_stdout(output), contextlib.redirect_stderr(output):
+            try:
+                os.chdir(request["cwd"])
+                status = main(request["argv"])
+            except Exception:
+                traceback.print_exc()
+                status = 1
+        self.wfile.write((json.dumps({"status": status, "output": output.getvalue()}) + "\n").encode())
+
+class Server(socketserver.ForkingMixIn, socketserver.UnixStreamServer):
+    pass
+
+def serve(path):
+    # Left by an earlier server ; any other file is not ours to remove
+    if os.path.lexists(path):
+        if not stat.S_ISSOCK(os.lstat(path).st_mode):
+            print(f"Erreur : {path} existe et n'est pas une socket")
+            return 1
+        os.remove(path)
+    # Inherited by the forked requests
+    encryptions(0)
+    encryptions(1)
+    with Server(path, RequestHandler) as server:
+        print(f"Serveur en attente sur {path}")
+        # Stopped by Ctrl-C or kill, the socket is removed either way
+        signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+        try:
+            server.serve_forever()
+        except (KeyboardInterrupt, SystemExit):
+            pass
+        finally:
+            os.remove(path)
+    return 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) in (2, 3) and sys.argv[1] == "serve":
+        sys.exit(serve(sys.argv[2] if len(sys.argv) == 3 else SOCKET_PATH))
+    else:
+        sys.exit(main(sys.argv))
@@ -17,9 +17,36 @@ def lire_fichier_binaire(chemin_fichier):
         raise ValueError("Le fichier doit contenir exactement 16 lignes.")
     return np.array(matrice, dtype=np.uint8)
 
-def afficher_image(img_binaire, titre):
+# Reads a grayscale PGM file (P2 or P5), gives the matrix and the maximum value
+def lire_fichier_pgm(chemin_fichier):
+    with open(chemin_fichier, 'rb') as fichier:
+        donnees = fichier.read()
+    # Header : format, width, height, maximum, '#' comments allowed
+    valeurs, pos = [], 0
+    while len(valeurs) < 4:
+        while pos < len(donnees) and donnees[pos:pos + 1].isspace():
+            pos += 1
+        if donnees[pos:pos + 1] == b'#':
+            pos = donnees.index(b'\n', pos)
+            continue
+        debut = pos
+        while pos < len(donnees) and not donnees[pos:pos + 1].isspace():
+            pos += 1
+        valeurs.append(donnees[debut:pos].decode())
+    if valeurs[0] not in ('P2', 'P5'):
+        raise ValueError("Seuls les formats PGM P2 et P5 sont pris en charge.")
+    largeur, hauteur, maximum = int(valeurs[1]), int(valeurs[2]), int(valeurs[3])
+    if valeurs[0] == 'P2':
+        mots = [mot for ligne in donnees[pos:].decode().splitlines() for mot in ligne.split('#')[0].split()]
+        pixels = np.array([int(v) for v in mots[:largeur * hauteur]])
+    else:
+        # A single whitespace, then one byte per pixel, two big-endian above 255
+        pixels = np.frombuffer(donnees[pos + 1:], dtype='>u2' if maximum > 255 else np.uint8, count=largeur * hauteur)
+    return pixels.reshape(hauteur, largeur), maximum
+
+def afficher_image(img_binaire, titre, maximum=1):
     plt.gcf().set_facecolor('0.8')
-    plt.imshow(img_binaire, cmap='gray', vmin=0, vmax=1)
+    plt.imshow(img_binaire, cmap='gray', vmin=0, vmax=maximum)
     plt.title(titre)
     plt.axis('off')
     plt.show()
@@ -29,7 +56,10 @@ if len(sys.argv) < 2:
   raise ValueError("Veuillez fournir le nom du fichier image en argument.")
 
 image_filename = sys.argv[1]
-img = lire_fichier_binaire(image_filename)
+if image_filename.endswith('.pgm'):
+    img, maximum = lire_fichier_pgm(image_filename)
+else:
+    img, maximum = lire_fichier_binaire(image_filename), 1
 
 # Affichage
-afficher_image(img, "")
\ No newline at end of file
+afficher_image(img, "", maximum)
\ No newline at end of file